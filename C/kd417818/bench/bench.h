@@ -0,0 +1,132 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+//aktualny czas w nanosekundach (zegar monotoniczny)
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+//argument liczbowy z linii poleceń albo wartość domyślna
+static inline long arg_or(int argc, char** argv, int i, long def) {
+    if (i < argc)
+        return atol(argv[i]);
+    return def;
+}
+
+#define MAX_WORKER_COUNTS 32
+
+/* liczby wątków do przetestowania: z argumentu w postaci "1,2,4,8" albo
+domyślnie kolejne potęgi dwójki aż do liczby procesorów; zwraca ich liczbę */
+static inline size_t worker_counts(int argc, char** argv, int i, size_t* out) {
+    size_t n = 0;
+    if (i < argc) {
+        char* copy = strdup(argv[i]);
+        for (char* tok = strtok(copy, ","); tok != NULL && n < MAX_WORKER_COUNTS; tok = strtok(NULL, ","))
+            if (atol(tok) > 0)
+                out[n++] = atol(tok);
+        free(copy);
+        return n;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (long w = 1; w < cpus && n < MAX_WORKER_COUNTS - 1; w *= 2)
+        out[n++] = w;
+    out[n++] = cpus > 0 ? cpus : 1;
+    return n;
+}
+
+/* próbki opóźnień (w nanosekundach) dopisywane z wielu wątków naraz;
+ponad pojemność są pomijane */
+typedef struct samples {
+    uint64_t* v;
+    _Atomic size_t n;
+    size_t cap;
+} samples_t;
+
+static inline bool samples_init(samples_t* s, size_t cap) {
+    s->v = malloc(cap * sizeof(uint64_t));
+    s->cap = cap;
+    atomic_init(&s->n, 0);
+    return s->v != NULL;
+}
+
+static inline void samples_add(samples_t* s, uint64_t ns) {
+    size_t i = atomic_fetch_add_explicit(&s->n, 1, memory_order_relaxed);
+    if (i < s->cap)
+        s->v[i] = ns;
+}
+
+static inline int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+//kwantyl q zebranych próbek (sortuje je); 0, gdy nie ma żadnej
+static inline uint64_t samples_quantile(samples_t* s, double q) {
+    size_t n = atomic_load(&s->n);
+    if (n > s->cap)
+        n = s->cap;
+    if (n == 0)
+        return 0;
+    qsort(s->v, n, sizeof(uint64_t), cmp_u64);
+    return s->v[(size_t)(q * (n - 1))];
+}
+
+/* licznik sprzętowy procesora (perf_event_open, np. PERF_COUNT_HW_CACHE_MISSES)
+dla całego procesu w przestrzeni użytkownika - z wątkami utworzonymi później,
+więc otwierany przed startem systemu; -1, gdy niedostępny (maszyna wirtualna
+bez liczników, perf_event_paranoid) */
+static inline int hw_counter_open(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* stan licznika (wątki potomne liczą się dopiero po zakończeniu, więc czytany
+po actor_system_join) i zamknięcie go; -1 dla niedostępnego */
+static inline long hw_counter_close(int fd) {
+    if (fd < 0)
+        return -1;
+    uint64_t value;
+    long out = read(fd, &value, sizeof(value)) == sizeof(value) ? (long)value : -1;
+    close(fd);
+    return out;
+}
+
+/* wspólny format wyników wszystkich pomiarów (CSV): nagłówek, a potem wiersz
+na każdą liczbę wątków; pomiar może dopisać własne kolumny na końcu */
+#define BENCH_COLUMNS "bench,workers,ops,seconds,ops_per_sec,p50_ns,p99_ns"
+
+static inline void bench_header(const char* extra) {
+    printf("%s%s%s\n", BENCH_COLUMNS, extra != NULL ? "," : "", extra != NULL ? extra : "");
+}
+
+//wypisuje wspólne kolumny (bez końca wiersza) i zeruje próbki na następny przebieg
+static inline void bench_row(const char* bench, size_t workers, long ops, double seconds, samples_t* latency) {
+    uint64_t p50 = samples_quantile(latency, 0.50);
+    uint64_t p99 = samples_quantile(latency, 0.99);
+    printf("%s,%zu,%ld,%.6f,%.0f,%lu,%lu", bench, workers, ops, seconds, ops / seconds,
+           (unsigned long)p50, (unsigned long)p99);
+    atomic_store(&latency->n, 0);
+}
+
+#endif
@@ -0,0 +1,123 @@
+/* rozesłanie dużego bufora do wielu aktorów: osobna kopia dla każdego
+odbiorcy kontra wspólny bufor z licznikiem referencji; wynik w CSV
+mode,workers,receivers,rounds,buffer_kb,seconds,peak_rss_kb
+użycie: broadcast [odbiorcy [rundy [kb [wątki,...]]]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#define MSG_READY 1
+#define MSG_DATA 2
+
+long receivers, rounds;
+size_t buffer_bytes;
+bool use_shared;
+
+actor_id_t* children;
+_Atomic long ready;
+_Atomic long received;
+uint64_t start, finish;
+
+role_t role;
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+void broadcast_all() {
+    shared_buf_t* buf = shared_buf_create(buffer_bytes);
+    memset(shared_buf_data(buf), 1, buffer_bytes);
+
+    start = now_ns();
+    for (long r = 0; r < rounds; r++) {
+        if (use_shared) {
+            send_multicast_shared(children, receivers, MSG_DATA, buf);
+            continue;
+        }
+        for (long i = 0; i < receivers; i++) {
+            void* copy = malloc(buffer_bytes);
+            memcpy(copy, shared_buf_data(buf), buffer_bytes);
+            message_t msg = { .message_type = MSG_DATA, .nbytes = buffer_bytes, .data = copy };
+            send_message(children[i], msg);
+        }
+    }
+    shared_buf_release(buf);
+    send_message(actor_id_self(), msg_godie);
+}
+
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    //odbiorcy tworzą się łańcuchem, każdy następnego - żadna skrzynka się nie zapcha
+    message_t spawn = { .message_type = MSG_SPAWN, .data = &role };
+    if ((actor_id_t)data == -1) {
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    long i = atomic_fetch_add(&ready, 1);
+    children[i] = actor_id_self();
+    if (i + 1 < receivers) {
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    //ostatni daje znać korzeniowi (id 0)
+    message_t msg = { .message_type = MSG_READY };
+    send_message(0, msg);
+}
+
+void on_ready(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    broadcast_all();
+}
+
+void on_data(void** stateptr, size_t nbytes, void* data) {
+    (void)nbytes;
+    long* got = (long*)stateptr;
+    if (!use_shared)
+        free(data);
+    if (atomic_fetch_add(&received, 1) + 1 == receivers * rounds)
+        finish = now_ns();
+    if (++*got == rounds)
+        send_message(actor_id_self(), msg_godie);
+}
+
+int main(int argc, char** argv) {
+    receivers = arg_or(argc, argv, 1, 1000);
+    rounds = arg_or(argc, argv, 2, 2);
+    buffer_bytes = (size_t)arg_or(argc, argv, 3, 256) * 1024;
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 4, counts);
+    children = malloc(receivers * sizeof(actor_id_t));
+    if (children == NULL)
+        return 1;
+
+    act_t prompts[] = { hello, on_ready, on_data };
+    role.nprompts = 3;
+    role.prompts = prompts;
+
+    //wspólny bufor najpierw - szczytowe zużycie pamięci rośnie tylko w górę
+    for (int mode = 1; mode >= 0; mode--) {
+        use_shared = mode == 1;
+        for (size_t c = 0; c < ncounts; c++) {
+            atomic_store(&ready, 0);
+            atomic_store(&received, 0);
+            actor_id_t root;
+            actor_system_config_t config = { .workers = counts[c] };
+            if (actor_system_create_ex(&root, &role, &config) != 0)
+                return 1;
+            actor_system_join(root);
+
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            printf("%s,%zu,%ld,%ld,%zu,%f,%ld\n", use_shared ? "shared" : "copy", counts[c], receivers,
+                   rounds, buffer_bytes / 1024, (finish - start) / 1e9, usage.ru_maxrss);
+        }
+    }
+    free(children);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/* długi łańcuch jak w silni: posiadacz żetonu tworzy następnika, czeka na jego
+MSG_HELLO (odpowiedź MSG_READY), przekazuje mu żeton i umiera - naraz żyje
+tylko kilku aktorów, a łańcuch może być dłuższy niż CAST_LIMIT; wynik we
+wspólnym CSV (bench.h), operacja to jedno przejście żetonu razem
+z tworzeniem następnika, opóźnienie - takiego przejścia; do tego na przejście:
+ile razy kolejny prompt łańcucha działał na innym procesorze niż poprzedni
+(rodzic i dziecko rozmawiają ze sobą, więc każda zmiana to komunikat i stan
+ściągane z pamięci podręcznej innego rdzenia) i chybienia pamięci podręcznej
+z licznika procesora (-1, gdy niedostępny)
+użycie: chain [przejścia [wątki,...]] */
+#define _GNU_SOURCE
+#include "cacti.h"
+#include "bench.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MSG_READY 1
+#define MSG_TOKEN 2
+
+long hops;
+
+//żeton ma naraz jeden aktor, więc jego stan może być wspólny
+long depth;
+uint64_t token_at, start, finish;
+samples_t latency;
+//procesor poprzedniego promptu łańcucha i liczba zmian procesora
+int last_cpu;
+long cpu_changes;
+
+role_t role;
+message_t msg_spawn = { .message_type = MSG_SPAWN, .data = &role };
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+//prompty łańcucha działają po kolei, każdy wywołany przez poprzedni
+void note_cpu() {
+    int cpu = sched_getcpu();
+    if (last_cpu >= 0 && cpu != last_cpu)
+        cpu_changes++;
+    last_cpu = cpu;
+}
+
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    note_cpu();
+    if ((actor_id_t)data == -1) {
+        depth = 0;
+        start = token_at = now_ns();
+        send_message(actor_id_self(), msg_spawn);
+        return;
+    }
+    message_t ready = { .message_type = MSG_READY, .data = (void*)actor_id_self() };
+    send_message((actor_id_t)data, ready);
+}
+
+void on_ready(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    note_cpu();
+    message_t token = { .message_type = MSG_TOKEN };
+    send_message((actor_id_t)data, token);
+    send_message(actor_id_self(), msg_godie);
+}
+
+void on_token(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    note_cpu();
+    uint64_t now = now_ns();
+    samples_add(&latency, now - token_at);
+    token_at = now;
+    if (++depth < hops) {
+        send_message(actor_id_self(), msg_spawn);
+        return;
+    }
+    finish = now;
+    send_message(actor_id_self(), msg_godie);
+}
+
+int main(int argc, char** argv) {
+    hops = arg_or(argc, argv, 1, 500000);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 2, counts);
+    if (hops < 1 || !samples_init(&latency, hops))
+        return 1;
+
+    act_t prompts[] = { hello, on_ready, on_token };
+    role.nprompts = 3;
+    role.prompts = prompts;
+
+    bench_header("cpu_changes_per_hop,cache_misses_per_hop");
+    for (size_t c = 0; c < ncounts; c++) {
+        actor_id_t root;
+        actor_system_config_t config = { .workers = counts[c] };
+        last_cpu = -1;
+        cpu_changes = 0;
+        int misses = hw_counter_open(PERF_COUNT_HW_CACHE_MISSES);
+        if (actor_system_create_ex(&root, &role, &config) != 0)
+            return 1;
+        actor_system_join(root);
+        long missed = hw_counter_close(misses);
+
+        bench_row("chain", counts[c], hops, (finish - start) / 1e9, &latency);
+        printf(",%.3f,%.2f\n", (double)cpu_changes / hops, missed < 0 ? -1.0 : (double)missed / hops);
+    }
+    free(latency.v);
+    return 0;
+}
@@ -0,0 +1,126 @@
+/* opóźnienie ważnej ścieżki pod obciążeniem: dwa aktory sterujące odbijają
+komunikat, a wielu aktorów masowych (klasy zwykłej) cały czas ma pracę;
+sterujące raz są klasy zwykłej, raz wysokiej; wynik we wspólnym CSV (bench.h),
+operacja to jedno odbicie, opóźnienie - jednego przejścia komunikatu
+użycie: classes [odbicia [masowi [ns_pracy [wątki,...]]]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MSG_PING 1
+#define MSG_PONG 2
+#define MSG_WORK 1
+
+long round_trips, bulk, work_ns;
+long done;
+atomic_bool stop;
+uint64_t start, finish;
+samples_t oneway;
+
+role_t control_role, bulk_role;
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+//nbytes niesie czas wysłania
+void send_stamped(actor_id_t to, message_type_t type) {
+    message_t msg = { .message_type = type, .nbytes = now_ns(), .data = (void*)actor_id_self() };
+    send_message(to, msg);
+}
+
+//korzeń (sterujący) tworzy masowych i partnera; partner zaczyna odbijanie
+void control_hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    if ((actor_id_t)data != -1) {
+        send_stamped((actor_id_t)data, MSG_PONG);
+        return;
+    }
+    message_t spawn_bulk = { .message_type = MSG_SPAWN, .data = &bulk_role };
+    message_t spawn_control = { .message_type = MSG_SPAWN, .data = &control_role };
+    for (long i = 0; i < bulk; i++)
+        send_message(actor_id_self(), spawn_bulk);
+    send_message(actor_id_self(), spawn_control);
+}
+
+void ping(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    samples_add(&oneway, now_ns() - nbytes);
+    send_stamped((actor_id_t)data, MSG_PONG);
+}
+
+void pong(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    uint64_t now = now_ns();
+    if (done == 0)
+        start = now;
+    else
+        samples_add(&oneway, now - nbytes);
+    if (done++ < round_trips) {
+        send_stamped((actor_id_t)data, MSG_PING);
+        return;
+    }
+    finish = now;
+    atomic_store(&stop, true);
+    send_message((actor_id_t)data, msg_godie);
+    send_message(actor_id_self(), msg_godie);
+}
+
+void bulk_hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    message_t msg = { .message_type = MSG_WORK };
+    send_message(actor_id_self(), msg);
+}
+
+//masowy aktor pracuje i od razu zleca sobie następną porcję
+void bulk_work(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    uint64_t until = now_ns() + work_ns;
+    while (now_ns() < until) {}
+    message_t msg = { .message_type = MSG_WORK };
+    send_message(actor_id_self(), atomic_load(&stop) ? msg_godie : msg);
+}
+
+int main(int argc, char** argv) {
+    round_trips = arg_or(argc, argv, 1, 500);
+    bulk = arg_or(argc, argv, 2, 32);
+    work_ns = arg_or(argc, argv, 3, 200);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 4, counts);
+    //wszystkie MSG_SPAWN korzenia muszą się zmieścić w jego skrzynce
+    if (bulk < 0 || bulk + 2 > ACTOR_QUEUE_LIMIT || !samples_init(&oneway, 2 * (round_trips + 1)))
+        return 1;
+
+    act_t control_prompts[] = { control_hello, ping, pong };
+    control_role.nprompts = 3;
+    control_role.prompts = control_prompts;
+    act_t bulk_prompts[] = { bulk_hello, bulk_work };
+    bulk_role.nprompts = 2;
+    bulk_role.prompts = bulk_prompts;
+
+    bench_header("control_class,bulk_actors");
+    int classes[] = { ACTOR_CLASS_NORMAL, ACTOR_CLASS_HIGH };
+    for (int k = 0; k < 2; k++) {
+        control_role.sched_class = classes[k];
+        for (size_t c = 0; c < ncounts; c++) {
+            done = 0;
+            atomic_store(&stop, false);
+            actor_id_t root;
+            actor_system_config_t config = { .workers = counts[c] };
+            if (actor_system_create_ex(&root, &control_role, &config) != 0)
+                return 1;
+            actor_system_join(root);
+
+            bench_row("classes", counts[c], round_trips, (finish - start) / 1e9, &oneway);
+            printf(",%s,%ld\n", classes[k] == ACTOR_CLASS_HIGH ? "high" : "normal", bulk);
+        }
+    }
+    free(oneway.v);
+    return 0;
+}
@@ -0,0 +1,144 @@
+/* koszt wywołania promptu: aktor dostaje komunikaty ośmiu typów w losowej
+kolejności (system wywołuje prompty przez tablicę roli), a potem te same prompty
+są wywoływane bez systemu (dispatch_call, workers 0) - przez tablicę i przez
+switch z role.h (prompty wstawione w switch), w kolejności losowej i cyklicznej
+(przewidywalnej); wynik we wspólnym CSV (bench.h), ns_per_msg - czas na
+komunikat (wywołanie)
+użycie: dispatch [komunikaty [wątki,...]] */
+#include "role.h"
+#include "bench.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//tyle komunikatów krąży naraz
+#define IN_FLIGHT 64
+#define TYPES 8
+//powtórzenia sekwencji w pomiarze samych wywołań
+#define CALL_ROUNDS 20
+
+typedef struct step {
+    long v;
+} step_t;
+
+#define MIX_PROMPTS(P) \
+    P(mix, s0, step_t) \
+    P(mix, s1, step_t) \
+    P(mix, s2, step_t) \
+    P(mix, s3, step_t) \
+    P(mix, s4, step_t) \
+    P(mix, s5, step_t) \
+    P(mix, s6, step_t) \
+    P(mix, s7, step_t)
+
+ROLE_DECLARE(mix, MIX_PROMPTS)
+
+long messages;
+long sent, received;
+//typy kolejnych komunikatów (losowe, stałe między przebiegami)
+message_type_t* types;
+//w systemie prompt wysyła następny komunikat, bez niego tylko liczy
+bool in_system;
+
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+void send_next() {
+    step_t step = { .v = sent };
+    send_message_inline(actor_id_self(), types[sent++ % messages], &step, sizeof(step));
+}
+
+void mix_hello(void** stateptr, actor_id_t parent) {
+    (void)parent;
+    *stateptr = (void*)0;
+    for (int i = 0; i < IN_FLIGHT && sent < messages; i++)
+        send_next();
+}
+
+static inline void consume() {
+    if (!in_system)
+        return;
+    if (++received == messages)
+        send_message(actor_id_self(), msg_godie);
+    else if (sent < messages)
+        send_next();
+}
+
+//każdy prompt zmienia stan trochę inaczej, żeby nie dało się ich scalić
+#define MIX_STEP(n) \
+    void mix_s##n(void** stateptr, const step_t* msg) { \
+        *stateptr = (void*)((long)*stateptr * 31 + msg->v + n); \
+        consume(); \
+    }
+MIX_STEP(0)
+MIX_STEP(1)
+MIX_STEP(2)
+MIX_STEP(3)
+MIX_STEP(4)
+MIX_STEP(5)
+MIX_STEP(6)
+MIX_STEP(7)
+
+ROLE_DEFINE(mix, MIX_PROMPTS)
+
+//pętla samych wywołań; wynik (stan) wypisywany, żeby kompilator jej nie usunął
+double call_loop(bool use_switch, const message_type_t* seq, long* state) {
+    void* s = (void*)0;
+    step_t step = { .v = 1 };
+    uint64_t start = now_ns();
+    for (int r = 0; r < CALL_ROUNDS; r++)
+        for (long i = 0; i < messages; i++) {
+            if (use_switch)
+                mix_dispatch(&s, seq[i], sizeof(step), &step);
+            else
+                mix_prompts[seq[i]](&s, sizeof(step), &step);
+        }
+    *state = (long)s;
+    return (now_ns() - start) / 1e9;
+}
+
+int main(int argc, char** argv) {
+    messages = arg_or(argc, argv, 1, 1000000);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 2, counts);
+    types = malloc(messages * sizeof(message_type_t));
+    message_type_t* cyclic = malloc(messages * sizeof(message_type_t));
+    samples_t latency;
+    if (messages < 1 || types == NULL || cyclic == NULL || !samples_init(&latency, 1))
+        return 1;
+    unsigned seed = 1;
+    for (long i = 0; i < messages; i++) {
+        types[i] = mix_msg_s0 + rand_r(&seed) % TYPES;
+        cyclic[i] = mix_msg_s0 + i % TYPES;
+    }
+
+    bench_header("mode,pattern,ns_per_msg");
+    in_system = true;
+    for (size_t c = 0; c < ncounts; c++) {
+        sent = received = 0;
+        actor_id_t root;
+        actor_system_config_t config = { .workers = counts[c] };
+        uint64_t start = now_ns();
+        if (actor_system_create_ex(&root, &mix_role, &config) != 0)
+            return 1;
+        actor_system_join(root);
+        double seconds = (now_ns() - start) / 1e9;
+        bench_row("dispatch", counts[c], messages, seconds, &latency);
+        printf(",table,random,%.2f\n", seconds * 1e9 / messages);
+    }
+
+    in_system = false;
+    for (int pattern = 0; pattern < 2; pattern++)
+        for (int mode = 0; mode < 2; mode++) {
+            long state;
+            double seconds = call_loop(mode == 1, pattern == 0 ? types : cyclic, &state);
+            bench_row("dispatch_call", 0, messages * CALL_ROUNDS, seconds, &latency);
+            printf(",%s,%s,%.2f\n", mode == 0 ? "table" : "switch", pattern == 0 ? "random" : "cyclic",
+                   seconds * 1e9 / (messages * CALL_ROUNDS));
+            fprintf(stderr, "stan %ld\n", state);
+        }
+    free(latency.v);
+    free(cyclic);
+    free(types);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/* rozgałęzienie i zbieranie odpowiedzi: korzeń rozsyła zapytanie do wszystkich
+dzieci (send_multicast) i czeka na odpowiedź każdego, zanim zacznie następną
+rundę; wynik we wspólnym CSV (bench.h), operacja to jedno zapytanie
+z odpowiedzią, opóźnienie - całej rundy
+użycie: fanout [dzieci [rundy [wątki,...]]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MSG_READY 1
+#define MSG_REQUEST 2
+#define MSG_REPLY 3
+
+long children_count, rounds;
+
+actor_id_t* children;
+_Atomic long ready;
+//stan korzenia - używa go tylko korzeń
+long round_no, replies;
+uint64_t round_start, first_round, finish;
+samples_t latency;
+
+role_t role;
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+void start_round() {
+    round_start = now_ns();
+    replies = 0;
+    message_t request = { .message_type = MSG_REQUEST, .data = (void*)actor_id_self() };
+    send_multicast(children, children_count, request);
+}
+
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    //dzieci tworzą się łańcuchem, każde następne - żadna skrzynka się nie zapcha
+    message_t spawn = { .message_type = MSG_SPAWN, .data = &role };
+    if ((actor_id_t)data == -1) {
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    long i = atomic_fetch_add(&ready, 1);
+    children[i] = actor_id_self();
+    if (i + 1 < children_count) {
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    //ostatnie daje znać korzeniowi (id 0)
+    message_t msg = { .message_type = MSG_READY };
+    send_message(0, msg);
+}
+
+void on_ready(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    round_no = 0;
+    start_round();
+    first_round = round_start;
+}
+
+void on_request(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    message_t reply = { .message_type = MSG_REPLY };
+    send_message((actor_id_t)data, reply);
+}
+
+void on_reply(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    if (++replies < children_count)
+        return;
+    samples_add(&latency, now_ns() - round_start);
+    if (++round_no < rounds) {
+        start_round();
+        return;
+    }
+    finish = now_ns();
+    send_multicast(children, children_count, msg_godie);
+    send_message(actor_id_self(), msg_godie);
+}
+
+int main(int argc, char** argv) {
+    children_count = arg_or(argc, argv, 1, 512);
+    rounds = arg_or(argc, argv, 2, 2000);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 3, counts);
+    //odpowiedzi jednej rundy muszą się zmieścić w skrzynce korzenia
+    if (children_count < 1 || children_count >= ACTOR_QUEUE_LIMIT || children_count >= CAST_LIMIT)
+        return 1;
+    children = malloc(children_count * sizeof(actor_id_t));
+    if (children == NULL || !samples_init(&latency, rounds))
+        return 1;
+
+    act_t prompts[] = { hello, on_ready, on_request, on_reply };
+    role.nprompts = 4;
+    role.prompts = prompts;
+
+    bench_header("children");
+    for (size_t c = 0; c < ncounts; c++) {
+        atomic_store(&ready, 0);
+        actor_id_t root;
+        actor_system_config_t config = { .workers = counts[c] };
+        if (actor_system_create_ex(&root, &role, &config) != 0)
+            return 1;
+        actor_system_join(root);
+        //bez tworzenia dzieci
+        double seconds = (finish - first_round) / 1e9;
+
+        bench_row("fanout", counts[c], children_count * rounds, seconds, &latency);
+        printf(",%ld\n", children_count);
+    }
+    free(latency.v);
+    free(children);
+    return 0;
+}
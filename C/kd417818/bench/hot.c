@@ -0,0 +1,145 @@
+/* obciążenie skupione na jednym aktorze: klienci w zamkniętej pętli wysyłają
+zapytanie i czekają na odpowiedź; z zadanym prawdopodobieństwem zapytanie
+trafia do gorącego aktora, w przeciwnym razie do losowego z pozostałych;
+wynik we wspólnym CSV (bench.h), operacja to zapytanie z odpowiedzią,
+opóźnienie - od wysłania zapytania do odebrania odpowiedzi
+użycie: hot [klienci [cele [zapytania_na_klienta [procent_gorących [wątki,...]]]]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MSG_READY 1
+#define MSG_START 2
+#define MSG_REQUEST 3
+#define MSG_RESPONSE 4
+
+long clients, targets, requests, hot_percent;
+
+//najpierw klienci, potem cele; pierwszy cel jest gorący
+actor_id_t* actors;
+_Atomic long ready;
+_Atomic long finished;
+uint64_t start, finish;
+samples_t latency;
+
+//stan klienta (osobna linia pamięci podręcznej na każdego)
+typedef struct client {
+    _Alignas(64) long done;
+    unsigned seed;
+} client_t;
+
+client_t* client_state;
+
+role_t role;
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+//nbytes niesie czas wysłania zapytania, data - nadawcę
+void send_request(client_t* client) {
+    long r = rand_r(&client->seed);
+    actor_id_t* target = actors + clients;
+    if (r % 100 >= hot_percent)
+        target += r / 100 % targets;
+    message_t msg = { .message_type = MSG_REQUEST, .nbytes = now_ns(), .data = (void*)actor_id_self() };
+    send_message(*target, msg);
+}
+
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)nbytes;
+    //aktorzy tworzą się łańcuchem, każdy następnego - żadna skrzynka się nie zapcha
+    message_t spawn = { .message_type = MSG_SPAWN, .data = &role };
+    if ((actor_id_t)data == -1) {
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    long i = atomic_fetch_add(&ready, 1);
+    actors[i] = actor_id_self();
+    *stateptr = (void*)i;
+    if (i + 1 < clients + targets) {
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    //ostatni daje znać korzeniowi (id 0)
+    message_t msg = { .message_type = MSG_READY };
+    send_message(0, msg);
+}
+
+void on_ready(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    message_t msg = { .message_type = MSG_START };
+    start = now_ns();
+    send_multicast(actors, clients, msg);
+}
+
+void on_start(void** stateptr, size_t nbytes, void* data) {
+    (void)nbytes;
+    (void)data;
+    send_request(&client_state[(long)*stateptr]);
+}
+
+void on_request(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    message_t msg = { .message_type = MSG_RESPONSE, .nbytes = nbytes };
+    send_message((actor_id_t)data, msg);
+}
+
+void on_response(void** stateptr, size_t nbytes, void* data) {
+    (void)data;
+    samples_add(&latency, now_ns() - nbytes);
+    client_t* client = &client_state[(long)*stateptr];
+    if (++client->done < requests) {
+        send_request(client);
+        return;
+    }
+    if (atomic_fetch_add(&finished, 1) + 1 < clients)
+        return;
+    //ostatni klient kończy pomiar i zamyka system
+    finish = now_ns();
+    send_multicast(actors, clients + targets, msg_godie);
+    send_message(0, msg_godie);
+}
+
+int main(int argc, char** argv) {
+    clients = arg_or(argc, argv, 1, 64);
+    targets = arg_or(argc, argv, 2, 64);
+    requests = arg_or(argc, argv, 3, 20000);
+    hot_percent = arg_or(argc, argv, 4, 50);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 5, counts);
+    //wszystkie zapytania naraz muszą się zmieścić w skrzynce gorącego aktora
+    if (clients < 1 || clients >= ACTOR_QUEUE_LIMIT || targets < 1 || requests < 1
+        || clients + targets >= CAST_LIMIT || hot_percent < 0 || hot_percent > 100)
+        return 1;
+    actors = malloc((clients + targets) * sizeof(actor_id_t));
+    client_state = aligned_alloc(_Alignof(client_t), clients * sizeof(client_t));
+    if (actors == NULL || client_state == NULL || !samples_init(&latency, clients * requests))
+        return 1;
+
+    act_t prompts[] = { hello, on_ready, on_start, on_request, on_response };
+    role.nprompts = 5;
+    role.prompts = prompts;
+
+    bench_header("clients,targets,hot_percent");
+    for (size_t c = 0; c < ncounts; c++) {
+        atomic_store(&ready, 0);
+        atomic_store(&finished, 0);
+        for (long i = 0; i < clients; i++)
+            client_state[i] = (client_t){ .done = 0, .seed = i + 1 };
+        actor_id_t root;
+        actor_system_config_t config = { .workers = counts[c] };
+        if (actor_system_create_ex(&root, &role, &config) != 0)
+            return 1;
+        actor_system_join(root);
+
+        bench_row("hot", counts[c], clients * requests, (finish - start) / 1e9, &latency);
+        printf(",%ld,%ld,%ld\n", clients, targets, hot_percent);
+    }
+    free(latency.v);
+    free(client_state);
+    free(actors);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/* porównanie skrzynek komunikatów: dawnej (lista z mallociem pod mutexem)
+i obecnej (kolejka MPSC z mailbox.h); kilku nadawców, jeden odbiorca;
+wynik w CSV impl,producers,messages,send_ns,recv_p50_ns,recv_p99_ns */
+#include "cacti.h"
+#include "mailbox.h"
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//dawna skrzynka - tak jak w cacti.c przed kolejką MPSC
+typedef struct lnode {
+    message_t val;
+    struct lnode* next;
+} lnode_t;
+
+typedef struct locked_mailbox {
+    lnode_t* first;
+    lnode_t* last;
+    int len;
+    pthread_mutex_t lock;
+} locked_mailbox_t;
+
+int locked_send(locked_mailbox_t* q, message_t message) {
+    pthread_mutex_lock(&q->lock);
+    if (q->len == ACTOR_QUEUE_LIMIT) {
+        pthread_mutex_unlock(&q->lock);
+        return -3;
+    }
+    lnode_t* new = malloc(sizeof(lnode_t));
+    new->val = message;
+    new->next = NULL;
+    q->len++;
+    if (q->last == NULL)
+        q->first = q->last = new;
+    else {
+        q->last->next = new;
+        q->last = new;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return 0;
+}
+
+bool locked_receive(locked_mailbox_t* q, message_t* message) {
+    pthread_mutex_lock(&q->lock);
+    lnode_t* temp = q->first;
+    if (temp == NULL) {
+        pthread_mutex_unlock(&q->lock);
+        return false;
+    }
+    q->len--;
+    q->first = temp->next;
+    if (q->first == NULL)
+        q->last = NULL;
+    pthread_mutex_unlock(&q->lock);
+    *message = temp->val;
+    free(temp);
+    return true;
+}
+
+int lockfree_send(mailbox_t* mb, message_t message) {
+    mnode_t* node = mnode_alloc();
+    node->val = message;
+    int reserved = mailbox_reserve(mb, 0, ACTOR_QUEUE_LIMIT);
+    if (reserved < 0) {
+        mnode_free(node);
+        return reserved;
+    }
+    mailbox_push(mb, node);
+    return 0;
+}
+
+long producers, per_producer;
+bool lockfree;
+locked_mailbox_t locked;
+mailbox_t mailbox;
+_Atomic uint64_t send_ns_total;
+
+void* producer(void* arg) {
+    (void)arg;
+    uint64_t spent = 0;
+    for (long i = 0; i < per_producer; i++) {
+        uint64_t t0 = now_ns();
+        message_t message = { .message_type = MSG_HELLO, .nbytes = t0 };
+        int err;
+        do {
+            err = lockfree ? lockfree_send(&mailbox, message) : locked_send(&locked, message);
+        } while (err == -3);
+        spent += now_ns() - t0;
+    }
+    atomic_fetch_add(&send_ns_total, spent);
+    mnode_cache_flush();
+    return NULL;
+}
+
+void run(bool use_lockfree) {
+    lockfree = use_lockfree;
+    long total = producers * per_producer;
+    uint64_t* latency = malloc(total * sizeof(uint64_t));
+    atomic_store(&send_ns_total, 0);
+
+    pthread_t threads[producers];
+    for (long i = 0; i < producers; i++)
+        pthread_create(&threads[i], NULL, producer, NULL);
+
+    //odbiorca - odlicza komunikaty paczkami, tak jak wątek puli
+    long received = 0;
+    while (received < total) {
+        if (lockfree) {
+            uint64_t n = mailbox_count(&mailbox);
+            for (uint64_t i = 0; i < n; i++) {
+                mnode_t* node = mailbox_pop_wait(&mailbox);
+                latency[received++] = now_ns() - node->val.nbytes;
+                mnode_free(node);
+            }
+            mailbox_release(&mailbox, n);
+        }
+        else {
+            message_t message;
+            while (locked_receive(&locked, &message))
+                latency[received++] = now_ns() - message.nbytes;
+        }
+    }
+
+    for (long i = 0; i < producers; i++)
+        pthread_join(threads[i], NULL);
+
+    qsort(latency, total, sizeof(uint64_t), cmp_u64);
+    printf("%s,%ld,%ld,%.1f,%lu,%lu\n", lockfree ? "lockfree" : "locked", producers, total,
+           (double)atomic_load(&send_ns_total) / total,
+           (unsigned long)latency[total / 2], (unsigned long)latency[total * 99 / 100]);
+    free(latency);
+}
+
+int main(int argc, char** argv) {
+    producers = arg_or(argc, argv, 1, 4);
+    per_producer = arg_or(argc, argv, 2, 200000);
+
+    locked.first = locked.last = NULL;
+    locked.len = 0;
+    pthread_mutex_init(&locked.lock, NULL);
+    mailbox_init(&mailbox, 0);
+
+    run(false);
+    run(true);
+
+    pthread_mutex_destroy(&locked.lock);
+    mnode_cache_flush();
+    return 0;
+}
@@ -0,0 +1,99 @@
+/* komunikaty z małym ładunkiem: kopia na stercie (malloc u nadawcy, free
+u odbiorcy) kontra kopia w węźle skrzynki (send_message_inline); wynik w CSV
+mode,workers,messages,payload_bytes,seconds,msgs_per_sec
+użycie: payload [komunikaty [wątki,...]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MSG_HEAP 1
+#define MSG_INLINE 2
+
+//tyle komunikatów krąży naraz
+#define IN_FLIGHT 64
+
+typedef struct payload {
+    long seq;
+    long from;
+    double values[3];
+} payload_t;
+
+long messages;
+long sent, received;
+bool use_inline;
+
+role_t role;
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+//aktor wysyła komunikaty sam do siebie
+void send_next() {
+    payload_t p = { .seq = sent++, .from = actor_id_self(), .values = { 1.0, 2.0, 3.0 } };
+    if (use_inline) {
+        send_message_inline(actor_id_self(), MSG_INLINE, &p, sizeof(p));
+        return;
+    }
+    payload_t* copy = malloc(sizeof(payload_t));
+    memcpy(copy, &p, sizeof(p));
+    message_t msg = { .message_type = MSG_HEAP, .nbytes = sizeof(p), .data = copy };
+    send_message(actor_id_self(), msg);
+}
+
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    for (int i = 0; i < IN_FLIGHT && sent < messages; i++)
+        send_next();
+}
+
+void consume(payload_t* p) {
+    (void)p;
+    if (++received == messages)
+        send_message(actor_id_self(), msg_godie);
+    else if (sent < messages)
+        send_next();
+}
+
+void heap(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    consume(data);
+    free(data);
+}
+
+void in_node(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    consume(data);
+}
+
+int main(int argc, char** argv) {
+    messages = arg_or(argc, argv, 1, 1000000);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 2, counts);
+
+    act_t prompts[] = { hello, heap, in_node };
+    role.nprompts = 3;
+    role.prompts = prompts;
+
+    for (int mode = 0; mode < 2; mode++) {
+        use_inline = mode == 1;
+        for (size_t c = 0; c < ncounts; c++) {
+            sent = received = 0;
+            actor_id_t root;
+            actor_system_config_t config = { .workers = counts[c] };
+            uint64_t start = now_ns();
+            if (actor_system_create_ex(&root, &role, &config) != 0)
+                return 1;
+            actor_system_join(root);
+            double seconds = (now_ns() - start) / 1e9;
+            printf("%s,%zu,%ld,%zu,%f,%.0f\n", use_inline ? "inline" : "heap", counts[c],
+                   messages, sizeof(payload_t), seconds, messages / seconds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+/* opóźnienie pobudki: dwa aktory odbijają komunikat; wynik we wspólnym CSV
+(bench.h), operacja to jedno odbicie tam i z powrotem, opóźnienie - jednego
+przejścia komunikatu; dodatkowo przełączenia kontekstu na odbicie
+użycie: pingpong [odbicia [wątki,...]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/resource.h>
+
+#define MSG_PING 1
+#define MSG_PONG 2
+
+long round_trips;
+long done;
+samples_t oneway;
+
+actor_id_t root, partner;
+role_t role;
+
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+//nbytes niesie czas wysłania
+void send_stamped(actor_id_t to, message_type_t type) {
+    message_t msg = { .message_type = type, .nbytes = now_ns(), .data = (void*)actor_id_self() };
+    send_message(to, msg);
+}
+
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    if (actor_id_self() == root) {
+        message_t spawn = { .message_type = MSG_SPAWN, .data = &role };
+        send_message(root, spawn);
+        return;
+    }
+    send_stamped((actor_id_t)data, MSG_PONG);
+}
+
+void ping(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    uint64_t now = now_ns();
+    samples_add(&oneway, now - nbytes);
+    send_stamped((actor_id_t)data, MSG_PONG);
+}
+
+void pong(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    uint64_t now = now_ns();
+    if (done > 0)
+        samples_add(&oneway, now - nbytes);
+    partner = (actor_id_t)data;
+    if (done++ < round_trips) {
+        send_stamped(partner, MSG_PING);
+        return;
+    }
+    send_message(partner, msg_godie);
+    send_message(root, msg_godie);
+}
+
+int main(int argc, char** argv) {
+    round_trips = arg_or(argc, argv, 1, 100000);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 2, counts);
+    if (!samples_init(&oneway, 2 * (round_trips + 1)))
+        return 1;
+
+    act_t prompts[] = { hello, ping, pong };
+    role.nprompts = 3;
+    role.prompts = prompts;
+
+    bench_header("vol_ctx_switches_per_op,invol_ctx_switches_per_op");
+    for (size_t c = 0; c < ncounts; c++) {
+        done = 0;
+        struct rusage before, after;
+        getrusage(RUSAGE_SELF, &before);
+        actor_system_config_t config = { .workers = counts[c] };
+        uint64_t start = now_ns();
+        if (actor_system_create_ex(&root, &role, &config) != 0)
+            return 1;
+        actor_system_join(root);
+        double seconds = (now_ns() - start) / 1e9;
+        getrusage(RUSAGE_SELF, &after);
+
+        bench_row("pingpong", counts[c], round_trips, seconds, &oneway);
+        printf(",%.3f,%.3f\n", (double)(after.ru_nvcsw - before.ru_nvcsw) / round_trips,
+               (double)(after.ru_nivcsw - before.ru_nivcsw) / round_trips);
+    }
+    free(oneway.v);
+    return 0;
+}
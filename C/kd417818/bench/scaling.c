@@ -0,0 +1,117 @@
+/* przepustowość systemu aktorów w zależności od liczby wątków:
+pierścień aktorów, po którym krąży kilka żetonów; wynik w CSV
+workers,actors,tokens,messages,seconds,msgs_per_sec
+użycie: scaling [aktorzy [żetony [przeskoki [wątki,...]]]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MSG_JOIN 1
+#define MSG_NEXT 2
+#define MSG_TOKEN 3
+#define MSG_DONE 4
+
+long actors, tokens, hops;
+
+actor_id_t root;
+actor_id_t* ring;
+long joined, done;
+uint64_t start, end;
+
+role_t role;
+
+message_t msg_spawn = { .message_type = MSG_SPAWN, .data = &role };
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    if (actor_id_self() == root)
+        return;
+    message_t msg = { .message_type = MSG_JOIN, .data = (void*)actor_id_self() };
+    send_message((actor_id_t)data, msg);
+}
+
+//dziecko zgłasza się korzeniowi; gdy są wszystkie, zamykam pierścień i puszczam żetony
+void join(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    ring[joined++] = (actor_id_t)data;
+    if (joined < actors)
+        return;
+
+    for (long i = 0; i < actors; i++) {
+        message_t msg = { .message_type = MSG_NEXT, .data = (void*)ring[(i + 1) % actors] };
+        send_message(ring[i], msg);
+    }
+    start = now_ns();
+    for (long i = 0; i < tokens; i++) {
+        message_t msg = { .message_type = MSG_TOKEN, .data = (void*)(intptr_t)hops };
+        send_message(ring[i % actors], msg);
+    }
+}
+
+void next(void** stateptr, size_t nbytes, void* data) {
+    (void)nbytes;
+    *stateptr = data;
+}
+
+void token(void** stateptr, size_t nbytes, void* data) {
+    (void)nbytes;
+    intptr_t left = (intptr_t)data;
+    message_t msg = { .message_type = MSG_TOKEN, .data = (void*)(left - 1) };
+    if (left == 0) {
+        msg.message_type = MSG_DONE;
+        send_message(root, msg);
+        return;
+    }
+    //przy pełnej skrzynce następnika próbuję do skutku
+    while (send_message((actor_id_t)*stateptr, msg) == -3) {}
+}
+
+void finish(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    if (++done < tokens)
+        return;
+    end = now_ns();
+    for (long i = 0; i < actors; i++)
+        send_message(ring[i], msg_godie);
+    send_message(root, msg_godie);
+}
+
+int main(int argc, char** argv) {
+    actors = arg_or(argc, argv, 1, 64);
+    tokens = arg_or(argc, argv, 2, 64);
+    hops = arg_or(argc, argv, 3, 20000);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 4, counts);
+
+    act_t prompts[] = { hello, join, next, token, finish };
+    role.nprompts = sizeof(prompts) / sizeof(prompts[0]);
+    role.prompts = prompts;
+
+    ring = malloc(actors * sizeof(actor_id_t));
+    if (ring == NULL)
+        return 1;
+
+    for (size_t c = 0; c < ncounts; c++) {
+        joined = done = 0;
+        actor_system_config_t config = { .workers = counts[c] };
+        if (actor_system_create_ex(&root, &role, &config) != 0)
+            return 1;
+        for (long i = 0; i < actors; i++)
+            send_message(root, msg_spawn);
+        actor_system_join(root);
+
+        double seconds = (end - start) / 1e9;
+        long messages = tokens * (hops + 1);
+        printf("%zu,%ld,%ld,%ld,%.6f,%.0f\n", counts[c], actors, tokens, messages, seconds, messages / seconds);
+    }
+    free(ring);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/* koniec systemu z wieloma bezczynnymi aktorami (domyślnie prawie CAST_LIMIT),
+którzy sami nigdy by nie umarli: drzewo aktorów tworzonych przez MSG_SPAWN,
+a potem zamknięcie - MSG_GODIE wysłane przez program do każdego z osobna
+(godie), actor_system_shutdown z SHUTDOWN_DRAIN (drain) albo SHUTDOWN_NOW
+(now); wynik we wspólnym CSV (bench.h), seconds - zamknięcie razem z
+actor_system_join, do tego osobno oba czasy w milisekundach
+użycie: shutdown [aktorzy [wątki,...]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//tylu dzieci tworzy każdy aktor
+#define FANOUT 8
+
+long actors;
+//numer następnego aktora do stworzenia i liczba tych, które już działają
+_Atomic long claimed, born;
+actor_id_t* ids;
+role_t role;
+
+message_t msg_spawn = { .message_type = MSG_SPAWN, .data = &role };
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+//każdy aktor zapisuje swoje id i tworzy do FANOUT dzieci, a potem tylko czeka
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    ids[atomic_fetch_add(&born, 1)] = actor_id_self();
+    for (int i = 0; i < FANOUT && atomic_fetch_add(&claimed, 1) < actors; i++)
+        send_message(actor_id_self(), msg_spawn);
+}
+
+int main(int argc, char** argv) {
+    actors = arg_or(argc, argv, 1, CAST_LIMIT - 1);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 2, counts);
+    ids = malloc((actors + 1) * sizeof(actor_id_t));
+    samples_t latency;
+    if (actors < 1 || ids == NULL || !samples_init(&latency, 1))
+        return 1;
+
+    act_t prompts[] = { hello };
+    role.nprompts = 1;
+    role.prompts = prompts;
+
+    const char* modes[] = { "godie", "drain", "now" };
+    bench_header("mode,shutdown_ms,join_ms");
+    for (int mode = 0; mode < 3; mode++)
+        for (size_t c = 0; c < ncounts; c++) {
+            atomic_store(&claimed, 0);
+            atomic_store(&born, 0);
+            actor_id_t root;
+            actor_system_config_t config = { .workers = counts[c] };
+            if (actor_system_create_ex(&root, &role, &config) != 0)
+                return 1;
+            while (atomic_load(&born) < actors + 1)
+                sched_yield();
+
+            uint64_t start = now_ns();
+            if (mode == 0) {
+                for (long i = 0; i <= actors; i++)
+                    send_message(ids[i], msg_godie);
+            }
+            else
+                actor_system_shutdown(mode == 1 ? SHUTDOWN_DRAIN : SHUTDOWN_NOW, SHUTDOWN_NO_TIMEOUT);
+            uint64_t stopped = now_ns();
+            actor_system_join(root);
+            uint64_t end = now_ns();
+
+            bench_row("shutdown", counts[c], actors + 1, (end - start) / 1e9, &latency);
+            printf(",%s,%.3f,%.3f\n", modes[mode], (stopped - start) / 1e6, (end - stopped) / 1e6);
+        }
+    free(latency.v);
+    free(ids);
+    return 0;
+}
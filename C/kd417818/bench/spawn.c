@@ -0,0 +1,131 @@
+/* masowe tworzenie aktorów przez MSG_SPAWN (domyślnie do CAST_LIMIT): korzeń
+tworzy kilku aktorów-rodziców, a każdy z nich swoją część dzieci; wynik we
+wspólnym CSV (bench.h), operacja to stworzenie aktora, opóźnienie - średni czas
+stworzenia w paczce; dodatkowo liczba przydziałów pamięci i szczytowe RSS
+użycie: spawn [dzieci [rodzice [wątki,...]]] */
+#include "cacti.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+
+#define MSG_MORE 1
+
+//liczba przydziałów pamięci (linkowane z --wrap=malloc itd.)
+_Atomic long allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_aligned_alloc(size_t alignment, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+
+void* __wrap_aligned_alloc(size_t alignment, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_aligned_alloc(alignment, size);
+}
+
+#define SPAWN_BATCH 256
+
+long actors, spawners;
+_Atomic long spawned;
+samples_t latency;
+actor_id_t root;
+role_t role;
+
+message_t spawns[SPAWN_BATCH];
+message_t msg_godie = { .message_type = MSG_GODIE };
+
+void send_more(uint64_t stamp, long batch) {
+    message_t msg = { .message_type = MSG_MORE, .nbytes = stamp, .data = (void*)batch };
+    send_message(actor_id_self(), msg);
+}
+
+//korzeń tworzy rodziców, rodzice zlecają sobie kolejne paczki MSG_SPAWN, dzieci od razu umierają
+void hello(void** stateptr, size_t nbytes, void* data) {
+    (void)nbytes;
+    if (actor_id_self() == root) {
+        send_messages(root, spawns, spawners);
+        send_message(root, msg_godie);
+    }
+    else if ((actor_id_t)data == root) {
+        *stateptr = (void*)(actors / spawners); //ile dzieci jeszcze stworzyć
+        send_more(0, 0);
+    }
+    else
+        send_message(actor_id_self(), msg_godie);
+}
+
+/* MSG_MORE przychodzi po paczce MSG_SPAWN wysłanej tuż przed nim, więc cała
+paczka jest już obsłużona; nbytes niesie czas wysłania, data - wielkość paczki */
+void more(void** stateptr, size_t nbytes, void* data) {
+    if (data != NULL)
+        samples_add(&latency, (now_ns() - nbytes) / (long)data);
+    long left = (long)*stateptr;
+    uint64_t stamp = now_ns();
+    int sent = left > 0 ? send_messages(actor_id_self(), spawns, left < SPAWN_BATCH ? left : SPAWN_BATCH) : 0;
+    if (sent > 0) {
+        left -= sent;
+        atomic_fetch_add(&spawned, sent);
+    }
+    *stateptr = (void*)left;
+    if (left > 0 || sent > 0)
+        send_more(stamp, sent > 0 ? sent : 0);
+    else
+        send_message(actor_id_self(), msg_godie);
+}
+
+int main(int argc, char** argv) {
+    spawners = arg_or(argc, argv, 2, 8);
+    actors = arg_or(argc, argv, 1, CAST_LIMIT - 1 - spawners);
+    size_t counts[MAX_WORKER_COUNTS];
+    size_t ncounts = worker_counts(argc, argv, 3, counts);
+    if (spawners < 1 || spawners > SPAWN_BATCH)
+        return 1;
+
+    if (!samples_init(&latency, actors / SPAWN_BATCH + spawners + 1))
+        return 1;
+
+    act_t prompts[] = { hello, more };
+    role.nprompts = 2;
+    role.prompts = prompts;
+    for (int i = 0; i < SPAWN_BATCH; i++) {
+        spawns[i].message_type = MSG_SPAWN;
+        spawns[i].data = &role;
+    }
+
+    bench_header("spawners,allocations,peak_rss_kb");
+    for (size_t c = 0; c < ncounts; c++) {
+        atomic_store(&spawned, 0);
+        atomic_store(&allocations, 0);
+        actor_system_config_t config = { .workers = counts[c] };
+        uint64_t start = now_ns();
+        if (actor_system_create_ex(&root, &role, &config) != 0)
+            return 1;
+        actor_system_join(root);
+        double seconds = (now_ns() - start) / 1e9;
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        bench_row("spawn", counts[c], atomic_load(&spawned), seconds, &latency);
+        printf(",%ld,%ld,%ld\n", spawners, atomic_load(&allocations), usage.ru_maxrss);
+    }
+    free(latency.v);
+    return 0;
+}
@@ -1,4 +1,8 @@
+#define _GNU_SOURCE
 #include "cacti.h"
+#include "mailbox.h"
+#include "wheel.h"
+#include "coroutine.h"
 #include <pthread.h>
 #include <semaphore.h>
 #include <stddef.h>
@@ -10,27 +14,44 @@
 #include <signal.h>
 #include <errno.h>
 #include <unistd.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <limits.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+//czas w nanosekundach (zegar monotoniczny) - do liczników i śledzenia
+uint64_t clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
 //węzeł z id aktora
 typedef struct node {
     actor_id_t val;
     struct node* next;
+#ifdef CACTI_STATS
+    uint64_t since; //od kiedy aktor czeka w kolejce
+#endif
 } node_t;
 
-//tworzy węzeł z podanym id
-node_t* new_node(actor_id_t sth) {
-    node_t* new = (node_t*)malloc(sizeof(node_t));
-    if (new == NULL)
-        return NULL;
-    new->val = sth;
-    new->next = NULL;
-    return new;
-}
+//węzły kolejki przydzielane są paczkami po NODE_SLAB
+#define NODE_SLAB 256
+
+typedef struct node_slab {
+    struct node_slab* next;
+    node_t nodes[NODE_SLAB];
+} node_slab_t;
 
 typedef struct queue {
     node_t* first;
     node_t* last;
     int len;
+
+    //wolne węzły i paczki, z których pochodzą
+    node_t* free;
+    node_slab_t* slabs;
 } queue_t;
 
 queue_t* new_queue() {
@@ -39,11 +60,37 @@ queue_t* new_queue() {
         return NULL;
     new->first = new->last = NULL;
     new->len = 0;
+    new->free = NULL;
+    new->slabs = NULL;
+    return new;
+}
+
+//tworzy węzeł z podanym id
+node_t* new_node(queue_t* q, actor_id_t sth) {
+    if (q->free == NULL) {
+        node_slab_t* slab = (node_slab_t*)malloc(sizeof(node_slab_t));
+        if (slab == NULL)
+            return NULL;
+        slab->next = q->slabs;
+        q->slabs = slab;
+        for (int i = 0; i < NODE_SLAB; i++) {
+            slab->nodes[i].next = q->free;
+            q->free = &slab->nodes[i];
+        }
+    }
+
+    node_t* new = q->free;
+    q->free = new->next;
+    new->val = sth;
+    new->next = NULL;
+#ifdef CACTI_STATS
+    new->since = clock_ns();
+#endif
     return new;
 }
 
 bool queue_add(queue_t* q, actor_id_t id) {
-    node_t* new = new_node(id);
+    node_t* new = new_node(q, id);
     if (new == NULL)
         return false;
 
@@ -74,7 +121,8 @@ actor_id_t queue_get(queue_t* q) {
         q->last = NULL;
 
     actor_id_t id = temp->val;
-    free(temp);
+    temp->next = q->free;
+    q->free = temp;
     return id;
 }
 
@@ -86,584 +134,2989 @@ bool queue_empty(queue_t* q) {
     return false;
 }
 
-//węzeł z wiadomością
-typedef struct mnode {
-    message_t val;
-    struct mnode* next;
-} mnode_t;
+//węzły zwolnione przez wątek trzymane są lokalnie, nadmiar trafia do wspólnego magazynu
+#define MNODE_BATCH 64
+
+//nowe węzły przydzielane są paczkami po MNODE_SLAB
+#define MNODE_SLAB 1024
+
+typedef struct mnode_slab {
+    struct mnode_slab* next;
+    mnode_slot_t slots[MNODE_SLAB];
+} mnode_slab_t;
+
+typedef struct mnode_cache {
+    mnode_t* list;
+    size_t len;
+    //pokolenie magazynu, z którego pochodzą węzły - po zwolnieniu paczek są nieważne
+    size_t epoch;
+} mnode_cache_t;
+
+__thread mnode_cache_t mnode_cache = { NULL, 0, 0 };
+
+//wspólny magazyn wolnych węzłów, wymieniany paczkami po MNODE_BATCH
+pthread_mutex_t mnode_depot_lock = PTHREAD_MUTEX_INITIALIZER;
+mnode_t* mnode_depot = NULL;
+_Atomic size_t mnode_depot_len = 0;
+mnode_slab_t* mnode_slabs = NULL;
+_Atomic size_t mnode_epoch = 1;
+
+//przenosi do n węzłów z listy *from na początek listy *to, zwraca ile przeniósł
+size_t mnode_move(mnode_t** from, mnode_t** to, size_t n) {
+    size_t moved = 0;
+    while (moved < n && *from != NULL) {
+        mnode_t* node = *from;
+        *from = atomic_load_explicit(&node->next, memory_order_relaxed);
+        atomic_store_explicit(&node->next, *to, memory_order_relaxed);
+        *to = node;
+        moved++;
+    }
+    return moved;
+}
 
-//tworzy węzeł z podaną wiadomością
-mnode_t* new_mnode(message_t sth) {
-    mnode_t* new = (mnode_t*)malloc(sizeof(mnode_t));
-    if (new == NULL)
-        return NULL;
-    new->val = sth;
-    new->next = NULL;
-    return new;
+//pamięć podręczna wątku; węzły z poprzedniego pokolenia porzuca (ich pamięć już zwolniono)
+mnode_cache_t* my_mnode_cache() {
+    mnode_cache_t* cache = &mnode_cache;
+    size_t epoch = atomic_load_explicit(&mnode_epoch, memory_order_relaxed);
+    if (cache->epoch != epoch) {
+        cache->list = NULL;
+        cache->len = 0;
+        cache->epoch = epoch;
+    }
+    return cache;
 }
 
-typedef struct mqueue {
-    mnode_t* first;
-    mnode_t* last;
-    int len;
-} mqueue_t;
+//uzupełnia pamięć podręczną z magazynu albo z nowej paczki - trzeba mieć mnode_depot_lock
+void mnode_refill(mnode_cache_t* cache) {
+    if (mnode_depot == NULL) {
+        mnode_slab_t* slab = (mnode_slab_t*)malloc(sizeof(mnode_slab_t));
+        if (slab == NULL)
+            return;
+        slab->next = mnode_slabs;
+        mnode_slabs = slab;
+        for (int i = 0; i < MNODE_SLAB; i++) {
+            atomic_store_explicit(&slab->slots[i].node.next, mnode_depot, memory_order_relaxed);
+            mnode_depot = &slab->slots[i].node;
+        }
+        mnode_depot_len += MNODE_SLAB;
+    }
 
-mqueue_t* new_mqueue() {
-    mqueue_t* new = (mqueue_t*)malloc(sizeof(mqueue_t));
-    if (new == NULL)
-        return NULL;
-    new->first = new->last = NULL;
-    new->len = 0;
-    return new;
+    size_t moved = mnode_move(&mnode_depot, &cache->list, MNODE_BATCH);
+    mnode_depot_len -= moved;
+    cache->len += moved;
 }
 
-bool mqueue_add(mqueue_t* q, message_t message) {
-    mnode_t* new = new_mnode(message);
-    if (new == NULL)
-        return false;
-
-    q->len++;
+mnode_t* mnode_alloc() {
+    mnode_cache_t* cache = my_mnode_cache();
 
-    if (q->last == NULL) {
-        q->first = q->last = new;
-        return true;
+    if (cache->list == NULL) {
+        pthread_mutex_lock(&mnode_depot_lock);
+        mnode_refill(cache);
+        pthread_mutex_unlock(&mnode_depot_lock);
+        if (cache->list == NULL)
+            return NULL;
     }
-    
-    q->last->next = new;
-    q->last = new;
-    return true;
+
+    mnode_t* node = cache->list;
+    cache->list = atomic_load_explicit(&node->next, memory_order_relaxed);
+    cache->len--;
+    return node;
 }
 
-message_t mqueue_get(mqueue_t* q) {
-    //assert(q->first != NULL);
+void mnode_free(mnode_t* node) {
+    mnode_cache_t* cache = my_mnode_cache();
 
-    q->len--;
-    
-    mnode_t* temp = q->first;
-    q->first = q->first->next;
+    atomic_store_explicit(&node->next, cache->list, memory_order_relaxed);
+    cache->list = node;
+    cache->len++;
 
-    if (q->first == NULL)
-        q->last = NULL;
+    if (cache->len >= 2 * MNODE_BATCH) {
+        pthread_mutex_lock(&mnode_depot_lock);
+        cache->len -= MNODE_BATCH;
+        mnode_depot_len += mnode_move(&cache->list, &mnode_depot, MNODE_BATCH);
+        pthread_mutex_unlock(&mnode_depot_lock);
+    }
+}
 
-    message_t message = temp->val;
-    free(temp);
-    return message;
+//oddaje do magazynu wszystkie węzły z pamięci podręcznej wątku (np. przed jego końcem)
+void mnode_cache_flush() {
+    mnode_cache_t* cache = my_mnode_cache();
+    if (cache->list == NULL)
+        return;
+
+    pthread_mutex_lock(&mnode_depot_lock);
+    mnode_depot_len += mnode_move(&cache->list, &mnode_depot, cache->len);
+    cache->len = 0;
+    pthread_mutex_unlock(&mnode_depot_lock);
 }
 
-bool mqueue_empty(mqueue_t* q) {
-    if (q->first == NULL || q->last == NULL || q->len == 0) {
-        //assert(q->first == NULL && q->last == NULL && q->len == 0);
-        return true;
+/* zwalnia wszystkie paczki węzłów; wolno tylko, gdy żaden system nie działa -
+węzły w pamięci podręcznej innych wątków unieważnia zmiana pokolenia */
+void mnode_depot_clear() {
+    pthread_mutex_lock(&mnode_depot_lock);
+    while (mnode_slabs != NULL) {
+        mnode_slab_t* slab = mnode_slabs;
+        mnode_slabs = slab->next;
+        free(slab);
     }
-    return false;
+    mnode_depot = NULL;
+    mnode_depot_len = 0;
+    atomic_fetch_add(&mnode_epoch, 1);
+    pthread_mutex_unlock(&mnode_depot_lock);
 }
 
-typedef struct actor {
-
-    //kolejka komunikatów
-    mqueue_t* mailbox;
-
-    //mutex dostępu do kolejki komunikatów
-    pthread_mutex_t lock;
+struct shared_buf {
+    _Atomic size_t refs;
+    size_t nbytes;
+    _Alignas(max_align_t) unsigned char data[];
+};
 
-    role_t* role;
-    actor_id_t id;
+shared_buf_t* shared_buf_create(size_t nbytes) {
+    shared_buf_t* buf = (shared_buf_t*)malloc(sizeof(shared_buf_t) + nbytes);
+    if (buf == NULL)
+        return NULL;
+    atomic_init(&buf->refs, 1);
+    buf->nbytes = nbytes;
+    return buf;
+}
 
-    bool dead; //czy jest martwy
-    bool working; //czy jakiś wątek na nim działa
+void* shared_buf_data(shared_buf_t* buf) {
+    return buf->data;
+}
 
-    void* state; //wskaźnik na stan tego aktora
-} actor_t;
+size_t shared_buf_size(const shared_buf_t* buf) {
+    return buf->nbytes;
+}
 
-//tworzy nowego aktora i zwraca wskaźnik na niego
-actor_t* new_actor(actor_id_t id, role_t* const role) {
-    actor_t* actor = (actor_t*)malloc(sizeof(actor_t));
+shared_buf_t* shared_buf_of(void* data) {
+    return (shared_buf_t*)((unsigned char*)data - offsetof(shared_buf_t, data));
+}
 
-    if (actor == NULL)
-        return NULL;
+void shared_buf_retain_n(shared_buf_t* buf, size_t n) {
+    atomic_fetch_add_explicit(&buf->refs, n, memory_order_relaxed);
+}
 
-    actor->mailbox = new_mqueue();
-    if (actor->mailbox == NULL) {
-        free(actor);
-        return NULL;
-    }
+//oddaje n referencji; ostatnia zwalnia bufor
+void shared_buf_release_n(shared_buf_t* buf, size_t n) {
+    if (n > 0 && atomic_fetch_sub_explicit(&buf->refs, n, memory_order_acq_rel) == n)
+        free(buf);
+}
 
-    actor->role = role;
-    actor->id = id;
+void shared_buf_retain(shared_buf_t* buf) {
+    shared_buf_retain_n(buf, 1);
+}
 
-    actor->dead = false;
-    actor->working = false;
+void shared_buf_release(shared_buf_t* buf) {
+    shared_buf_release_n(buf, 1);
+}
 
-    actor->state = NULL;
+//oddaje węzeł po obsłużeniu (albo wyrzuceniu) komunikatu razem z jego referencją do bufora
+void message_done(mnode_t* node) {
+    if (*mnode_shared(node) != NULL)
+        shared_buf_release(*mnode_shared(node));
+    mnode_free(node);
+}
 
-    if (pthread_mutex_init(&actor->lock, 0) != 0) {
-        free(actor->mailbox);
-        free(actor);
-        return NULL; //zwraca null jak się nie uda stworzyć mutexa
-    }
+//aktor zaczyna się na początku linii pamięci podręcznej i zajmuje ich kilka
+typedef struct actor {
 
-    return actor;
-}
+    //kolejka komunikatów (bez mutexa, patrz mailbox.h)
+    _Alignas(CACHE_LINE) mailbox_t mailbox;
 
-typedef struct pool {
+    role_t* role;
+    actor_id_t id;
 
-    pthread_t workers[POOL_SIZE];
+    void* state; //wskaźnik na stan tego aktora
 
-    //tutaj wieszają się wątki w przypadku braku gotowych do działania aktorów
-    pthread_cond_t passive;
-    int passive_workers;
+    //klasa szeregowania (z roli) - wyznacza kolejki gotowych, do których trafia
+    int sched_class;
+    //limit skrzynki (z roli albo systemu)
+    uint64_t mailbox_limit;
+
+    /* wysłania wstrzymane przez send_message_wait, po kolei; dopisuje je aktor
+    w prompcie, a dostarcza jego wątek na początku następnej aktywacji (patrz work) */
+    struct pending_send* outgoing;
+    struct pending_send** outgoing_tail;
+    //następny czekający na miejsce u tego samego odbiorcy (patrz waiters)
+    struct actor* next_waiter;
+
+    /* czekający na miejsce w skrzynce tego aktora: wstrzymani aktorzy (stos)
+    i zablokowane wątki spoza puli (liczba) */
+    _Atomic(struct actor*) waiters;
+    _Atomic uint32_t blocked_senders;
+
+    //korutyna promptu aktora korutynowego w toku (NULL - żaden); czekający w ask_message zostaje tu do wznowienia
+    struct coroutine* co;
+    //pytanie, na które odpowiada obsługiwany komunikat (reply_message)
+    ask_token_t asked_by;
+    /* własne pytanie aktora: numer (nieparzysty, dopóki czeka - odpowiadający
+    robi go parzystym) i licznik do wznowienia - odpowiedź i oddanie aktora
+    przez wątek odliczają po jednym, a kto zejdzie do zera, uszeregowuje go */
+    _Atomic uint32_t ask_seq;
+    _Atomic int ask_pending;
+
+#ifdef CACTI_STATS
+    //od kiedy aktor czeka w kolejce gotowych (pisze ten, kto go tam wkłada)
+    uint64_t ready_since;
+    //wątek poprzedniej aktywacji (SIZE_MAX - jeszcze żadnej); pisze wątek obsługujący aktora
+    size_t last_worker;
+    //pisze tylko wątek obsługujący aktora
+    _Atomic uint64_t messages;
+    //podbijają nadawcy, gdy skrzynka urośnie ponad dotychczasowy rekord
+    _Atomic uint64_t high_water;
+#endif
+} actor_t;
 
-    //czy można skończyć
-    //pthread_cond_t end;
+/* aktorzy przydzielani są ciągłymi kawałkami (segmentami) po ACTOR_CHUNK;
+segment raz przydzielony nigdy się nie przesuwa */
+#define ACTOR_CHUNK 1024
+//liczba segmentów potrzebna na CAST_LIMIT aktorów
+#define ACTOR_SEGMENTS ((CAST_LIMIT + ACTOR_CHUNK - 1) / ACTOR_CHUNK)
+
+/* id aktora to numer miejsca w tablicy (dolne bity), numer jego systemu (nad
+nim) i pokolenie tego miejsca (górna połowa) - miejsce po martwym aktorze
+dostaje kolejny aktor, ze starym id nie da się już do niego nic wysłać */
+#define ACTOR_SLOT_BITS 32
+#define ACTOR_SLOT_MASK (((uint64_t)1 << ACTOR_SLOT_BITS) - 1)
+#define ACTOR_SYSTEM_BITS 8
+//najwięcej systemów działających naraz
+#define ACTOR_SYSTEMS (1 << ACTOR_SYSTEM_BITS)
+#define ACTOR_PLACE_BITS (ACTOR_SLOT_BITS - ACTOR_SYSTEM_BITS)
+#define ACTOR_PLACE_MASK (((uint64_t)1 << ACTOR_PLACE_BITS) - 1)
+
+#if CAST_LIMIT > (1 << ACTOR_PLACE_BITS)
+#error "CAST_LIMIT nie mieści się w id aktora"
+#endif
+
+static inline size_t actor_slot(actor_id_t id) {
+    return (size_t)((uint64_t)id & ACTOR_PLACE_MASK);
+}
 
-    size_t dead_actors;
+static inline size_t actor_system_index(actor_id_t id) {
+    return (size_t)(((uint64_t)id >> ACTOR_PLACE_BITS) & (ACTOR_SYSTEMS - 1));
+}
 
-    //lista aktorów gotowych do działania
-    queue_t* queue;
+static inline uint64_t actor_generation(actor_id_t id) {
+    return (uint64_t)id >> ACTOR_SLOT_BITS;
+}
 
-    //tablica wskaźników na aktorów
-    actor_t** actors;
-    size_t size;
-    size_t number;
+typedef struct actor_segment {
+    actor_t actors[ACTOR_CHUNK];
+    //następne wolne miejsce na stosie wolnych (numer + 1, 0 - koniec)
+    _Atomic uint32_t next_free[ACTOR_CHUNK];
+} actor_segment_t;
 
-    //mutex pozwalający wątkowi na modyfikację listy
-    pthread_mutex_t mutex;
-    
-} pool_t;
+/* inicjuje nowego aktora w podanym miejscu areny i zwraca wskaźnik na niego;
+skrzynka na końcu - jej inicjacja publikuje aktora innym wątkom */
+actor_t* new_actor(actor_t* actor, actor_id_t id, role_t* const role, uint64_t mailbox_limit) {
+    actor->role = role;
+    actor->id = id;
 
-//zakładamy, że działa tylko jeden system jednocześnie
-pool_t* global_pool;
+    actor->state = NULL;
+    actor->sched_class = role->sched_class >= 0 && role->sched_class < ACTOR_CLASSES ? role->sched_class : ACTOR_CLASS_NORMAL;
+    actor->mailbox_limit = mailbox_limit;
+    actor->outgoing = NULL;
+    actor->outgoing_tail = &actor->outgoing;
+    //waiters i blocked_senders zostają - mogą tam być czekający na poprzednie pokolenie
+    actor->co = NULL;
+    actor->asked_by.asker = -1;
+    //ask_seq rośnie dalej - spóźniona odpowiedź do poprzedniego pokolenia nie pasuje
+
+#ifdef CACTI_STATS
+    atomic_store_explicit(&actor->messages, 0, memory_order_relaxed);
+    atomic_store_explicit(&actor->high_water, 0, memory_order_relaxed);
+    actor->last_worker = SIZE_MAX;
+#endif
+
+    mailbox_init(&actor->mailbox, actor_generation(id));
 
+    return actor;
+}
 
-actor_id_t add_actor(role_t* const role) {
+//pojemność lokalnej kolejki gotowych aktorów wątku (potęga dwójki)
+#define RUNQ_SIZE 256
+
+//co tyle aktywacji wątek zagląda najpierw do kolejki globalnej, żeby jej nie zagłodzić
+#define GLOBAL_QUEUE_INTERVAL 61
+
+#define CLASS_ROUND (ACTOR_CLASS_HIGH_SHARE + ACTOR_CLASS_NORMAL_SHARE + ACTOR_CLASS_BACKGROUND_SHARE)
+
+/* kolejność przeglądania klas przy kolejnych wyborach: w każdej rundzie
+CLASS_ROUND wyborów każda klasa jest pierwsza tyle razy, ile wynosi jej udział,
+potem reszta od najważniejszej */
+static inline const int* class_order(size_t tick) {
+    static const int orders[ACTOR_CLASSES][ACTOR_CLASSES] = {
+        { ACTOR_CLASS_HIGH, ACTOR_CLASS_NORMAL, ACTOR_CLASS_BACKGROUND },
+        { ACTOR_CLASS_NORMAL, ACTOR_CLASS_HIGH, ACTOR_CLASS_BACKGROUND },
+        { ACTOR_CLASS_BACKGROUND, ACTOR_CLASS_HIGH, ACTOR_CLASS_NORMAL },
+    };
+    size_t i = tick % CLASS_ROUND;
+    if (i < ACTOR_CLASS_HIGH_SHARE)
+        return orders[0];
+    if (i < ACTOR_CLASS_HIGH_SHARE + ACTOR_CLASS_NORMAL_SHARE)
+        return orders[1];
+    return orders[2];
+}
 
-    if (global_pool == NULL) {
-        return -1;
-    }
+/* lokalna kolejka gotowych aktorów wątku (jak runq w schedulerze Go):
+do końca dopisuje tylko właściciel, z początku zabierają właściciel
+i złodzieje przez CAS na head - bez żadnego mutexa */
+typedef struct runq {
+    _Atomic size_t head;
+    _Atomic size_t tail;
+    _Atomic actor_id_t buf[RUNQ_SIZE];
+} runq_t;
+
+void runq_init(runq_t* q) {
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    for (size_t i = 0; i < RUNQ_SIZE; i++)
+        atomic_init(&q->buf[i], -1);
+}
 
-    //może być tak, że dwa wątki jednocześnie chcą stworzyć aktora
-    pthread_mutex_lock(&global_pool->mutex);
+//wywołuje tylko właściciel; zwraca false, gdy kolejka jest pełna
+bool runq_push(runq_t* q, actor_id_t id) {
+    size_t h = atomic_load_explicit(&q->head, memory_order_acquire);
+    size_t t = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (t - h >= RUNQ_SIZE)
+        return false;
+    atomic_store_explicit(&q->buf[t % RUNQ_SIZE], id, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, t + 1, memory_order_release);
+    return true;
+}
 
-    if (global_pool->number == CAST_LIMIT) {
-        pthread_mutex_unlock(&global_pool->mutex);
-        return -1;
+//zabiera najstarszego aktora; może wywołać dowolny wątek
+actor_id_t runq_pop(runq_t* q) {
+    size_t h = atomic_load_explicit(&q->head, memory_order_acquire);
+    while (true) {
+        size_t t = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (t == h)
+            return -1;
+        actor_id_t id = atomic_load_explicit(&q->buf[h % RUNQ_SIZE], memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&q->head, &h, h + 1,
+                memory_order_release, memory_order_acquire))
+            return id;
     }
+}
 
-    if (global_pool->number == global_pool->size) {
-        actor_t** new_actors = realloc(global_pool->actors, global_pool->size * 2 * sizeof(actor_t*));
-        if (new_actors == NULL) {
-            pthread_mutex_unlock(&global_pool->mutex);
-            return -3; //nie udało się zaalokować pamięci
+/* przenosi połowę aktorów z kolejki ofiary do (pustej) kolejki złodzieja,
+zwraca jednego z nich do uruchomienia albo -1 */
+actor_id_t runq_steal(runq_t* victim, runq_t* thief) {
+    size_t h = atomic_load_explicit(&victim->head, memory_order_acquire);
+    while (true) {
+        size_t t = atomic_load_explicit(&victim->tail, memory_order_acquire);
+        size_t n = t - h;
+        if (n == 0 || n > RUNQ_SIZE) //n > RUNQ_SIZE - przeczytaliśmy nieaktualne head
+            return -1;
+        n = n - n / 2;
+
+        size_t tt = atomic_load_explicit(&thief->tail, memory_order_relaxed);
+        for (size_t i = 0; i < n; i++) {
+            actor_id_t id = atomic_load_explicit(&victim->buf[(h + i) % RUNQ_SIZE], memory_order_relaxed);
+            atomic_store_explicit(&thief->buf[(tt + i) % RUNQ_SIZE], id, memory_order_relaxed);
+        }
+        if (atomic_compare_exchange_weak_explicit(&victim->head, &h, h + n,
+                memory_order_release, memory_order_acquire)) {
+            //ostatniego zabieram od razu, resztę udostępniam innym
+            n--;
+            actor_id_t id = atomic_load_explicit(&thief->buf[(tt + n) % RUNQ_SIZE], memory_order_relaxed);
+            if (n > 0)
+                atomic_store_explicit(&thief->tail, tt + n, memory_order_release);
+            return id;
         }
-        global_pool->actors = new_actors;
-        global_pool->size *= 2;
-    }
-
-    if ((global_pool->actors[global_pool->number] = new_actor((actor_id_t)(global_pool->number), role)) == NULL) { 
-        pthread_mutex_unlock(&global_pool->mutex);
-        return -2; //nie udało się stworzyć aktora
     }
-    actor_id_t retval = (actor_id_t)(global_pool->number);
-    global_pool->number++;
-    
-    pthread_mutex_unlock(&global_pool->mutex);
-    return retval; //zwraca id dodanego aktora
 }
 
-//lokalny dla każdego wątku numer aktualnie przetwarzanego aktora
-__thread actor_id_t my_actor_id = -1;
-
+bool runq_empty(runq_t* q) {
+    return atomic_load(&q->head) == atomic_load(&q->tail);
+}
 
-void* work(void* data) { //argument to wskaźnik na indeks wątku w tablicy
+struct actor_system;
+
+//rodzaje zdarzeń śledzenia
+enum trace_kind {
+    TRACE_BEGIN,  //a: aktor - początek aktywacji
+    TRACE_END,    //a: aktor, n: przetworzone komunikaty
+    TRACE_SEND,   //a: nadawca (-1 spoza puli), b: odbiorca, flow, n: komunikaty
+    TRACE_RECV,   //a: aktor, flow - pierwszy komunikat aktywacji
+    TRACE_SPAWN,  //a: rodzic, b: dziecko
+    TRACE_GODIE   //a: aktor
+};
+
+typedef struct trace_event {
+    uint64_t tsc;
+    int64_t a;
+    int64_t b;
+    uint64_t flow;
+    uint32_t kind;
+    uint32_t n;
+} trace_event_t;
+
+/* bufor cykliczny zdarzeń - wątek puli pisze do swojego bez synchronizacji
+(najstarsze zdarzenia są nadpisywane), wątki spoza puli do wspólnego przez
+atomic_fetch_add; czytany dopiero po zakończeniu wszystkich wątków */
+typedef struct trace_ring {
+    _Atomic uint64_t next;
+    //kolejne numery wysłań (do łączenia wysłania z aktywacją odbiorcy)
+    _Atomic uint64_t flows;
+    trace_event_t events[TRACE_RING_SIZE];
+} trace_ring_t;
+
+#ifdef CACTI_STATS
+//przedziały histogramu czasu czekania: [2^i, 2^(i+1)) nanosekund, ostatni bez końca
+#define WAIT_BUCKETS 40
+
+/* liczniki wątku - każdy pisze tylko właściciel (zwykłym zapisem atomowym,
+bez operacji RMW), czytać może każdy; osobna linia pamięci podręcznej */
+typedef struct counters {
+    _Alignas(CACHE_LINE) _Atomic uint64_t messages;
+    _Atomic uint64_t activations;
+    _Atomic uint64_t steals;
+    _Atomic uint64_t parks;
+    _Atomic uint64_t idle_ns;
+    _Atomic uint64_t lock_waits;
+    _Atomic uint64_t lock_wait_ns;
+    _Atomic uint64_t global_taken;
+    _Atomic uint64_t global_wait_ns;
+    _Atomic uint64_t migrations;
+    //czekanie aktorów w kolejkach gotowych według klasy, z histogramem potęg dwójki
+    _Atomic uint64_t class_activations[ACTOR_CLASSES];
+    _Atomic uint64_t class_wait_ns[ACTOR_CLASSES];
+    _Atomic uint64_t class_wait_max_ns[ACTOR_CLASSES];
+    _Atomic uint64_t class_wait_hist[ACTOR_CLASSES][WAIT_BUCKETS];
+} counters_t;
+
+static inline void stat_add(_Atomic uint64_t* counter, uint64_t n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
 
-    //size_t my_id = *((size_t*) data);
-    free(data);
+#define STAT_ADD(worker, field, n) stat_add(&(worker)->stats.field, (n))
+#else
+#define STAT_ADD(worker, field, n) ((void)0)
+#endif
+
+typedef struct worker {
+    pthread_t thread;
+    size_t index;
+    struct actor_system* pool;
+
+    //aktorzy gotowi do działania, dodani przez aktorów działających na tym wątku (osobno dla każdej klasy)
+    runq_t runq[ACTOR_CLASSES];
+
+    //licznik aktywacji (do sprawdzania kolejki globalnej)
+    size_t ticks;
+    //stan generatora losowego do wybierania ofiary kradzieży
+    unsigned int seed;
+    /* obserwowany jedyny aktor w kolejce innego wątku (patrz STEAL_GRACE_NS):
+    kolejka, jego pozycja w niej (head) i od kiedy tam czeka */
+    runq_t* lone_q;
+    size_t lone_head;
+    uint64_t lone_since;
+
+    //tu wątek śpi, gdy nie ma pracy; budzi go unpark (a pilnującego zegarów i deskryptorów także kick_poller)
+    pthread_mutex_t park_lock;
+    pthread_cond_t park;
+    bool wakeup;
+    bool kicked;
+    //śpi w epoll_wait, nie na park - budzi się go przez io_wake_fd
+    bool polling;
+
+    //zdarzenia śledzenia (NULL, gdy wyłączone)
+    trace_ring_t* trace;
+
+    //kontekst wątku, gdy działa korutyna, i jego wolne korutyny (ze stosami)
+    co_context_t host;
+    struct coroutine* coroutines;
+    size_t ncoroutines;
+
+#ifdef CACTI_STATS
+    counters_t stats;
+#endif
+} worker_t;
+
+typedef struct actor_system {
+
+    //numer systemu (w id jego aktorów i uchwytach zegarów) i jego pokolenie (w uchwytach zegarów)
+    size_t index;
+    uint8_t generation;
+
+    worker_t* workers;
+    size_t nworkers;
+
+    //stos wątków śpiących z braku gotowych do działania aktorów (pod mutexem);
+    //pobudka trafia zawsze do konkretnego, na pewno śpiącego wątku
+    worker_t** idle;
+    _Atomic int idle_workers;
+
+    //wątki właśnie szukające pracy (także obudzone, które jeszcze nie ruszyły) -
+    //nowego aktora znajdzie któryś z nich, więc nie trzeba budzić kolejnych
+    _Atomic int searching;
+
+    //czas aktywnego czekania na pracę (zero na jednym procesorze - tam to nie ma sensu)
+    long spin_ns;
+    //ile jedyny aktor w cudzej kolejce czeka, zanim wolno go zabrać (też zero na jednym procesorze)
+    uint64_t steal_grace_ns;
+
+    //limit długości skrzynki komunikatów aktora
+    uint64_t mailbox_limit;
+
+    /* śledzenie: włącznik sprawdzany przy każdym zdarzeniu, plik na ślad,
+    bufor wątków spoza puli i punkt odniesienia do przeliczania taktów zegara */
+    bool tracing;
+    char* trace_file;
+    trace_ring_t* trace_outside;
+    uint64_t trace_tsc0;
+    uint64_t trace_ns0;
+
+    /* koniec systemu (wszyscy aktorzy martwi albo zatrzymanie) budzi czekających
+    w actor_system_shutdown - tylu ich jest (pod mutexem) */
+    pthread_cond_t end;
+    size_t shutdowns;
+
+    //żyjący aktorzy (stworzeni, a jeszcze nieodzyskani) - ich dotyczy CAST_LIMIT
+    _Atomic size_t live_actors;
+    //obsługiwane właśnie MSG_SPAWN - zamykanie czeka, aż nowi aktorzy będą gotowi
+    _Atomic size_t spawning;
+
+    /* system się nie uruchomił albo został zatrzymany (SHUTDOWN_NOW) - wątki mają
+    się skończyć mimo żyjących aktorów */
+    _Atomic bool stopping;
+    //trwa zamykanie SHUTDOWN_DRAIN - MSG_SPAWN nie tworzy nowych aktorów
+    _Atomic bool draining;
+
+    //listy aktorów gotowych do działania (dla każdej klasy), dodanych spoza
+    //wątków puli (albo gdy lokalna kolejka wątku była pełna)
+    queue_t* queue[ACTOR_CLASSES];
+    //długości tych list - do sprawdzania bez brania mutexa
+    _Atomic int queued[ACTOR_CLASSES];
+#ifdef CACTI_STATS
+    //najwięcej aktorów naraz na wszystkich tych listach (pod mutexem)
+    size_t queue_high_water;
+#endif
+
+    /* katalog aktorów: stała tablica ACTOR_SEGMENTS wskaźników na segmenty,
+    segmenty przydzielane w miarę potrzeby - nic nie jest przenoszone, więc
+    odczyt aktora nie potrzebuje mutexa */
+    _Atomic(actor_segment_t*)* segments;
+    //tyle miejsc w katalogu kiedykolwiek zajęto - numer następnego nowego
+    _Atomic size_t number;
+    /* stos miejsc odzyskanych po martwych aktorach: numer szczytu + 1 w dolnej
+    połowie, licznik zmian w górnej (przeciw ABA) */
+    _Atomic uint64_t free_slots;
+
+    //mutex chroniący stos śpiących wątków i kolejkę globalną
+    pthread_mutex_t mutex;
 
-    //printf("NOWY WONTEK %ld\n", my_id);
-    //actor_id_t* my_actor_id = malloc(sizeof(actor_id_t));
-   
-    while (true) {
+    /* zegary (send_message_after, send_message_every): koło pod własnym mutexem,
+    obsługiwane przez wątki puli między aktywacjami; takty liczone od timer_epoch */
+    pthread_mutex_t timer_lock;
+    wheel_t wheel;
+    uint64_t timer_epoch;
+    //kiedy (clock_ns) koło ma coś do zrobienia; UINT64_MAX - nie ma zegarów
+    _Atomic uint64_t timer_next;
+
+    /* deskryptory obserwowane przez aktorów (io_watch): epoll odpytują wątki
+    puli, szukając pracy; tablica obserwacji według numeru deskryptora, pod io_lock */
+    int epoll_fd;
+    int io_wake_fd;
+    pthread_mutex_t io_lock;
+    struct io_watch* io_watches;
+    size_t io_capacity;
+    _Atomic int io_watched;
+
+    /* śpiący wątek, który obudzi się sam na timer_next albo gotowość deskryptora
+    (śpi wtedy w epoll_wait); najwyżej jeden - reszta śpi bez limitu */
+    _Atomic(struct worker*) poller;
+    
+} pool_t;
 
-        //bierze mutex od listy aktorów
-        //printf("work %ld biore mutex\n", my_id);
-        if (pthread_mutex_lock(&global_pool->mutex) != 0) {}
-        //printf("work %ld wziąłem mutex\n", my_id);
+//lokalny dla każdego wątku numer aktualnie przetwarzanego aktora
+__thread actor_id_t my_actor_id = -1;
 
-        global_pool->passive_workers++;
+//wątek puli, na którym działamy (NULL poza pulą)
+__thread worker_t* my_worker = NULL;
+
+/* działające systemy według numeru; wpisy zmieniają się pod systems_lock, a
+czytane są bez niego - wątek spoza systemu najpierw go przypina (pin_system),
+bo ten może się właśnie kończyć */
+_Atomic(pool_t*) systems[ACTOR_SYSTEMS];
+pthread_mutex_t systems_lock = PTHREAD_MUTEX_INITIALIZER;
+size_t running_systems;
+
+/* przypięcia systemów według numeru - poza pulą, żeby licznik przeżył jej
+zwolnienie; actor_system_destroy wykreśla system i czeka, aż spadnie do zera */
+typedef struct system_pins {
+    _Alignas(CACHE_LINE) _Atomic size_t n;
+} system_pins_t;
+system_pins_t system_pins[ACTOR_SYSTEMS];
+
+/* numery zajęte od wpisania do końca zwalniania systemu (dłużej niż wpis w
+systems) i ich pokolenia - oba pod systems_lock */
+bool system_taken[ACTOR_SYSTEMS];
+uint8_t system_generations[ACTOR_SYSTEMS];
+
+//system domyślny (actor_system_create) - działa najwyżej jeden naraz
+pool_t* global_pool;
 
-        //if (global_pool->passive_workers == POOL_SIZE && queue_empty(global_pool->queue)) {
-        if (global_pool->dead_actors == global_pool->number && global_pool->dead_actors != 0) {
-            //fprintf(stderr, "wątek %ld wychodzi - wszyscy martwi - koniec pracy\n", my_id);
-            pthread_cond_signal(&global_pool->passive);
-            pthread_mutex_unlock(&global_pool->mutex);
-            //free(my_actor_id);
-            return NULL;
-        }
+//system aktora z podanego id albo NULL
+static inline pool_t* pool_of(actor_id_t id) {
+    if (id < 0)
+        return NULL;
+    return atomic_load_explicit(&systems[actor_system_index(id)], memory_order_acquire);
+}
 
-        //node_t* my_actor; //node z wskaźnikiem na mojego aktora
-        my_actor_id = queue_get(global_pool->queue);
-        
-        while (my_actor_id < 0 /*&& global_pool->working*/) {
-            
-            /* funkcja atomowo zwalnia mutex, który musiał być wcześniej w posiadaniu wątku 
-            i zawiesza wątek na zmiennej warunkowej cond (chwilowe wyjście z monitora); 
-            po obudzeniu wątek musi ponownie zdobyć mutex */
-            
-            //printf("brak aktora - work %ld wieszam sie\n", my_id);
-            if (pthread_cond_wait(&global_pool->passive, &global_pool->mutex) != 0) {  }
-            //printf("work %ld obudzony\n", my_id);
-
-            //obudzono mnie i koniec pracy
-            //if (global_pool->passive_workers == POOL_SIZE && queue_empty(global_pool->queue)) {
-            if (global_pool->dead_actors == global_pool->number && global_pool->dead_actors != 0) {
-                //fprintf(stderr, "wątek %ld obudzony - wszyscy martwi - koniec pracy\n", my_id);
-                if (pthread_cond_signal(&global_pool->passive) != 0) { }
-                pthread_mutex_unlock(&global_pool->mutex);
-                //free(my_actor_id);
-                return NULL;
-            }
-            
-            my_actor_id = queue_get(global_pool->queue);
-        }
-        //fprintf(stderr, "wątek %ld bierze aktora %ld\n", my_id, my_actor_id);
-        //assert(my_actor_id >= 0);
-        //pthread_setspecific(currentActor, my_actor_id);
-        //assert(actor_id_self() == my_actor_id);
-        ////fprintf(stderr, "%ld\n", my_actor_id);
-
-        //tutaj zakładam, że mam mutex od całęj puli
-        //oraz że w kolejce aktorów ktoś jest
-
-        // CZY BRAĆ MUTEX? KOLEJNOŚĆ!
-
-        global_pool->passive_workers--;
-        //assert(my_actor_id >= 0);
-        actor_t* actor = global_pool->actors[my_actor_id];
-
-        //biorę na chwilę mutex od tego aktora - nie wiem czy muszę
-        pthread_mutex_lock(&actor->lock);
-        //zaznaczam, że już nie jest w kolejce
-        actor->working = true;
-        //teraz to mój aktor
-        //my_actor_id = actor->id;
-        //zapamiętuje liczbę zadań do wykonania
-        int tasks = actor->mailbox->len;
-        //oddaję mutex od tego aktora
-        pthread_mutex_unlock(&actor->lock);
-
-        //oddaje mutex
-        //printf("work %ld oddaje mutex przed działaniem\n", my_id);
-        if (pthread_mutex_unlock(&global_pool->mutex) != 0) {}
-
-        //działa z tym aktorem    
-        
-        //printf("worker %ld: mój aktor to %ld\n", my_id, actor->id);
-        //assert(my_actor_id >= 0);
-
-        for (int i = 0; i < tasks; i++) {
-            message_t message;
-            
-            //biorę na chwilę mutex od tego aktora
-            pthread_mutex_lock(&actor->lock);
-
-            //zabieram komunikat z listy
-            message = mqueue_get(actor->mailbox);
-
-            if (message.message_type == MSG_GODIE) {
-                actor->dead = true;
-                //fprintf(stderr, "wątek %ld: aktor %ld przetwarza GO_DIE\n", my_id, my_actor_id);
-            }
+//system wątku, na którym działamy, a poza pulą - domyślny
+static inline pool_t* current_pool() {
+    return my_worker != NULL ? my_worker->pool : global_pool;
+}
 
-            //oddaję mutex od tego aktora
-            pthread_mutex_unlock(&actor->lock);
-
-            //printf("DZIAŁAM %ld\n", message.message_type);
-
-            if (message.message_type != MSG_GODIE) {
-                
-                if (message.message_type == MSG_SPAWN) {
-                    actor_id_t id = add_actor(message.data); //id tego, do którego wysyłam
-                    // sprawdzić czy id nieujemne
-                    message_t message;
-                    message.message_type = MSG_HELLO;
-                    message.data = (void*)(actor->id);
-                    message.nbytes = sizeof(message.data);
-
-                    send_message(id, message);
-                }
-                else {
-                    //printf("message type %ld\n", message.message_type);
-                    actor->role->prompts[message.message_type](&actor->state, message.nbytes, message.data);
-                } 
-            }
-        }
-        //assert(my_actor_id >= 0);
-        //biorę na chwilę mutex od tego aktora
-        pthread_mutex_lock(&actor->lock);
+/* przypina system spod numeru: do unpin_system nie zostanie zwolniony; NULL,
+gdy go nie ma (albo właśnie się kończy); własnego systemu wątek puli nie
+przypina - działa, dopóki działają jego wątki */
+static inline pool_t* pin_system(size_t index) {
+    if (my_worker != NULL && my_worker->pool->index == index)
+        return my_worker->pool;
+    //para z unlink_system: albo zobaczę NULL, albo niszczący zobaczy przypięcie
+    atomic_fetch_add(&system_pins[index].n, 1);
+    pool_t* pool = atomic_load(&systems[index]);
+    if (pool == NULL)
+        atomic_fetch_sub_explicit(&system_pins[index].n, 1, memory_order_release);
+    return pool;
+}
 
-        //doszły nam jeszcze nowe wiadomości do przetworzenia
-        if (!mqueue_empty(actor->mailbox)) {
+//przypina system aktora z podanego id
+static inline pool_t* pin_actor_system(actor_id_t id) {
+    if (id < 0)
+        return NULL;
+    return pin_system(actor_system_index(id));
+}
 
-            //fprintf(stderr, "wątek %ld wrzuca aktora %ld ponownie do kolejki\n", my_id, my_actor_id);
+static inline void unpin_system(pool_t* pool) {
+    if (pool != NULL && (my_worker == NULL || my_worker->pool != pool))
+        atomic_fetch_sub_explicit(&system_pins[pool->index].n, 1, memory_order_release);
+}
 
-            //zabieram mutex od całej puli
-            if (pthread_mutex_lock(&global_pool->mutex) != 0) {}
 
-            //dodeję aktora do listy gotowych do działania
-            //assert(my_actor_id >= 0);
-            queue_add(global_pool->queue, my_actor_id);
+//segment z podanym miejscem albo NULL
+actor_segment_t* segment_of(pool_t* pool, size_t slot) {
+    return atomic_load_explicit(&pool->segments[slot / ACTOR_CHUNK], memory_order_acquire);
+}
 
-            //budzę czekający ewentualnie wątek
-            pthread_cond_signal(&global_pool->passive);
+/* aktor zajmujący miejsce z podanego id albo NULL, jeśli takiego miejsca jeszcze
+(lub w ogóle) nie ma; pokolenie sprawdza dopiero rezerwacja w skrzynce */
+actor_t* actor_at(pool_t* pool, actor_id_t id) {
+    if (id < 0)
+        return NULL;
+    size_t slot = actor_slot(id);
+    if (slot >= CAST_LIMIT || slot >= atomic_load_explicit(&pool->number, memory_order_acquire))
+        return NULL;
+    actor_segment_t* segment = segment_of(pool, slot);
+    if (segment == NULL)
+        return NULL;
+    actor_t* actor = &segment->actors[slot % ACTOR_CHUNK];
+    //zarezerwowany, ale jeszcze niezainicjowany
+    if (!mailbox_ready(&actor->mailbox))
+        return NULL;
+    return actor;
+}
 
-            //oddaję mutex od całej puli
-            if (pthread_mutex_unlock(&global_pool->mutex) != 0) {}
+//zdejmuje miejsce ze stosu wolnych; false, gdy stos jest pusty
+bool pop_free_slot(pool_t* pool, size_t* slot) {
+    uint64_t top = atomic_load_explicit(&pool->free_slots, memory_order_acquire);
+    while ((top & ACTOR_SLOT_MASK) != 0) {
+        size_t s = (size_t)(top & ACTOR_SLOT_MASK) - 1;
+        uint32_t next = atomic_load_explicit(&segment_of(pool, s)->next_free[s % ACTOR_CHUNK], memory_order_relaxed);
+        uint64_t new_top = (((top >> ACTOR_SLOT_BITS) + 1) << ACTOR_SLOT_BITS) | next;
+        if (atomic_compare_exchange_weak_explicit(&pool->free_slots, &top, new_top,
+                memory_order_acq_rel, memory_order_acquire)) {
+            *slot = s;
+            return true;
         }
-        else if (actor->dead) {
-            //zabieram mutex od całej puli
-            if (pthread_mutex_lock(&global_pool->mutex) != 0) {}
+    }
+    return false;
+}
 
-            global_pool->dead_actors++;
-            //fprintf(stderr, "wątek %ld: aktor %ld dołącza do martwych, teraz %ld martwych, %ld wszystkich\n", my_id, actor_id_self(), global_pool->dead_actors, global_pool->number);
-            pthread_cond_signal(&global_pool->passive);
+void push_free_slot(pool_t* pool, size_t slot) {
+    _Atomic uint32_t* next = &segment_of(pool, slot)->next_free[slot % ACTOR_CHUNK];
+    uint64_t top = atomic_load_explicit(&pool->free_slots, memory_order_relaxed);
+    uint64_t new_top;
+    do {
+        atomic_store_explicit(next, (uint32_t)(top & ACTOR_SLOT_MASK), memory_order_relaxed);
+        new_top = (((top >> ACTOR_SLOT_BITS) + 1) << ACTOR_SLOT_BITS) | (slot + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_slots, &top, new_top,
+                memory_order_release, memory_order_relaxed));
+}
 
-            //oddaję mutex od całej puli
-            if (pthread_mutex_unlock(&global_pool->mutex) != 0) {}
-        }
+/* oddaje miejsce martwego aktora, którego skrzynka jest już pusta - wywołuje
+wątek, który go obsługiwał */
+void reclaim_actor(pool_t* pool, actor_t* actor) {
+    actor->role = NULL;
+    actor->state = NULL;
+    mailbox_retire(&actor->mailbox);
+    push_free_slot(pool, actor_slot(actor->id));
+    //dopiero teraz, żeby zajętych miejsc nigdy nie było więcej niż żyjących aktorów
+    atomic_fetch_sub(&pool->live_actors, 1);
+}
 
-        //a teraz już nie mam aktora
-        my_actor_id = -1;
-        //pthread_setspecific(currentActor, my_actor_id);
-        actor->working = false;
+static inline actor_id_t make_actor_id(pool_t* pool, uint64_t generation, size_t slot) {
+    return (actor_id_t)((generation << ACTOR_SLOT_BITS) | ((uint64_t)pool->index << ACTOR_PLACE_BITS) | slot);
+}
 
-        //oddaję mutex od tego aktora
-        pthread_mutex_unlock(&actor->lock);
+actor_id_t add_actor(pool_t* pool, role_t* const role) {
+
+    //limit dotyczy żyjących aktorów, nie wszystkich kiedykolwiek stworzonych
+    size_t live = atomic_load_explicit(&pool->live_actors, memory_order_relaxed);
+    do {
+        if (live >= CAST_LIMIT)
+            return -1;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->live_actors, &live, live + 1,
+                memory_order_acq_rel, memory_order_relaxed));
+
+    //limit skrzynki z roli, jeśli go podała
+    uint64_t limit = pool->mailbox_limit;
+    if (role->mailbox_limit > 0)
+        limit = role->mailbox_limit < MAILBOX_COUNT_MASK ? role->mailbox_limit : MAILBOX_COUNT_MASK;
+
+    //najpierw miejsce po martwym aktorze (z następnym pokoleniem)
+    size_t slot;
+    if (pop_free_slot(pool, &slot)) {
+        actor_t* place = &segment_of(pool, slot)->actors[slot % ACTOR_CHUNK];
+        actor_id_t id = make_actor_id(pool, mailbox_generation(&place->mailbox), slot);
+        new_actor(place, id, role, limit);
+        return id;
     }
 
-    //free(my_actor_id);
-    return NULL;
-}
-
-int actor_system_create(actor_id_t *actor, role_t *const role) {
-    /*
-    sigset_t block_mask, pending_mask;
-
-    sigemptyset (&block_mask);
-    sigaddset(&block_mask, SIGINT);                        //Blokuję SIGINT
-    if (sigprocmask(SIG_BLOCK, &block_mask, 0) == -1)
-        printf("sigprocmask block");
-    */
-   
-    if (global_pool != NULL) {
-        //printf("stary system istnieje\n");
+    /* nowe miejsce - wiele wątków może tworzyć aktorów jednocześnie, bez mutexa;
+    zajętych miejsc jest najwyżej tyle, co żyjących, więc numer mieści się w limicie */
+    slot = atomic_fetch_add_explicit(&pool->number, 1, memory_order_acq_rel);
+    if (slot >= CAST_LIMIT) {
+        //tylko gdy wcześniej przepadły miejsca z nieudanego przydziału segmentu
+        atomic_fetch_sub(&pool->live_actors, 1);
         return -1;
     }
 
-    global_pool = (pool_t*)malloc(sizeof(pool_t));
-    if (global_pool == NULL)
-        return -1; //nie udało się zaalokować pamięci
-    
-    if (pthread_cond_init(&global_pool->passive, 0) != 0) {
-        free(global_pool);
-        return -1; //nie udało się stworzyć zmiennej warunkowej
+    /* segment przydziela ten, kto go pierwszy potrzebuje; wyzerowany, żeby
+    niezainicjowani aktorzy mieli pusty koniec skrzynki; przegrany wyścig
+    oddaje swój segment */
+    _Atomic(actor_segment_t*)* dir = &pool->segments[slot / ACTOR_CHUNK];
+    actor_segment_t* segment = atomic_load_explicit(dir, memory_order_acquire);
+    if (segment == NULL) {
+        actor_segment_t* fresh = (actor_segment_t*)aligned_alloc(CACHE_LINE, sizeof(actor_segment_t));
+        if (fresh == NULL) {
+            //miejsce przepada, aktor się nie liczy
+            atomic_fetch_sub(&pool->live_actors, 1);
+            return -2; //nie udało się stworzyć aktora
+        }
+        memset(fresh, 0, sizeof(actor_segment_t));
+        if (atomic_compare_exchange_strong_explicit(dir, &segment, fresh,
+                memory_order_acq_rel, memory_order_acquire))
+            segment = fresh;
+        else
+            free(fresh);
     }
 
-    /*if (pthread_cond_init(&global_pool->end, 0) != 0)
-        return -1; //nie udało się stworzyć zmiennej warunkowej*/
-
-    global_pool->passive_workers = 0;
-    global_pool->dead_actors = 0;
-
-    //lista aktorów gotowych do działania (pusta)
-    global_pool->queue = new_queue();
+    actor_id_t id = make_actor_id(pool, 0, slot);
+    new_actor(&segment->actors[slot % ACTOR_CHUNK], id, role, limit);
+    return id; //zwraca id dodanego aktora
+}
 
-    //tworzy bufor aktorów
-    global_pool->actors = (actor_t**)malloc(sizeof(actor_t*));
-    if (global_pool->actors == NULL) {
-        free(global_pool->queue);
-        free(global_pool);
-        return -3; //nie udało się stworzyć mutexa
+//bierze mutex puli, licząc (z CACTI_STATS) czekanie na niego wątkom puli
+void lock_pool(pool_t* pool) {
+#ifdef CACTI_STATS
+    if (my_worker != NULL && my_worker->pool == pool) {
+        if (pthread_mutex_trylock(&pool->mutex) == 0)
+            return;
+        uint64_t start = clock_ns();
+        pthread_mutex_lock(&pool->mutex);
+        STAT_ADD(my_worker, lock_waits, 1);
+        STAT_ADD(my_worker, lock_wait_ns, clock_ns() - start);
+        return;
     }
-    global_pool->size = 1; //taka jest pojemność bufora
-    global_pool->number = 0; //tylu aktorów jest - indeks następnego wstawianego
+#endif
+    if (pthread_mutex_lock(&pool->mutex) != 0) {}
+}
 
-    if (pthread_mutex_init(&global_pool->mutex, 0) != 0) {
-        free(global_pool->actors);
-        free(global_pool->queue);
-        free(global_pool);
-        return -3; //nie udało się stworzyć mutexa
-    }
+#ifdef CACTI_STATS
+//zapisuje czas, jaki uruchamiany aktor klasy c czekał w kolejce gotowych
+void record_wait(worker_t* w, int c, uint64_t ns) {
+    size_t bucket = 0;
+    while (bucket + 1 < WAIT_BUCKETS && (ns >> (bucket + 1)) != 0)
+        bucket++;
+    STAT_ADD(w, class_activations[c], 1);
+    STAT_ADD(w, class_wait_ns[c], ns);
+    STAT_ADD(w, class_wait_hist[c][bucket], 1);
+    if (ns > atomic_load_explicit(&w->stats.class_wait_max_ns[c], memory_order_relaxed))
+        atomic_store_explicit(&w->stats.class_wait_max_ns[c], ns, memory_order_relaxed);
+}
+#endif
+
+//takty zegara procesora (TSC) - tam, gdzie go nie ma, nanosekundy
+static inline uint64_t trace_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return clock_ns();
+#endif
+}
 
-    pthread_attr_t attr;
-    if (pthread_attr_init (&attr) != 0) {
-        free(global_pool->actors);
-        free(global_pool->queue);
-        free(global_pool);
-        return -3; //nie udało się stworzyć mutexa
-    }
+//bufor śledzenia bieżącego wątku
+trace_ring_t* my_trace(pool_t* pool) {
+    if (my_worker != NULL && my_worker->pool == pool)
+        return my_worker->trace;
+    return pool->trace_outside;
+}
 
-    if (pthread_attr_setdetachstate (&attr,PTHREAD_CREATE_JOINABLE) != 0) {
-        free(global_pool->actors);
-        free(global_pool->queue);
-        free(global_pool);
-        return -3; //nie udało się stworzyć mutexa
+//zapisuje zdarzenie - tylko przy włączonym śledzeniu (patrz TRACE)
+void trace_event(pool_t* pool, enum trace_kind kind, int64_t a, int64_t b, uint64_t flow, uint32_t n) {
+    trace_ring_t* ring = my_trace(pool);
+    uint64_t i;
+    if (ring == pool->trace_outside)
+        i = atomic_fetch_add_explicit(&ring->next, 1, memory_order_relaxed);
+    else {
+        i = atomic_load_explicit(&ring->next, memory_order_relaxed);
+        atomic_store_explicit(&ring->next, i + 1, memory_order_relaxed);
     }
+    trace_event_t* e = &ring->events[i & (TRACE_RING_SIZE - 1)];
+    e->tsc = trace_clock();
+    e->kind = kind;
+    e->a = a;
+    e->b = b;
+    e->flow = flow;
+    e->n = n;
+}
 
-    for (int i = 0; i < POOL_SIZE; i++) {
-        size_t* worker_arg = malloc(sizeof(size_t));
-        *worker_arg = i;
+//nowy numer wysłania - unikalny w całym śladzie (numer bufora w górnych bitach)
+uint64_t trace_flow(pool_t* pool) {
+    trace_ring_t* ring = my_trace(pool);
+    if (ring == pool->trace_outside)
+        return ((pool->nworkers + 1) << 40) | (atomic_fetch_add_explicit(&ring->flows, 1, memory_order_relaxed) + 1);
+    uint64_t seq = atomic_load_explicit(&ring->flows, memory_order_relaxed) + 1;
+    atomic_store_explicit(&ring->flows, seq, memory_order_relaxed);
+    return ((my_worker->index + 1) << 40) | seq;
+}
 
-        if (pthread_create(&global_pool->workers[i], &attr, work, worker_arg) != 0) {
-            free(global_pool->actors);
-            free(global_pool->queue);
-            free(global_pool);
-            return -7;
-        }
-    }
+//wyłączone śledzenie kosztuje tylko sprawdzenie flagi
+#define TRACE(pool, kind, a, b, flow, n) \
+    do { if ((pool)->tracing) trace_event((pool), (kind), (a), (b), (flow), (n)); } while (0)
+
+//wątek zasypia do pobudki (która mogła już przyjść)
+void park(worker_t* w) {
+    pthread_mutex_lock(&w->park_lock);
+    while (!w->wakeup)
+        pthread_cond_wait(&w->park, &w->park_lock);
+    w->wakeup = false;
+    pthread_mutex_unlock(&w->park_lock);
+}
 
-    //tworzy pierwszego aktora
-    if (add_actor(role) < 0) {
-        free(global_pool->actors);
-        free(global_pool->queue);
-        free(global_pool);
-        return -7;
+//budzi wątek śpiący na park albo w epoll_wait - trzeba mieć jego park_lock
+static inline void signal_worker(worker_t* w) {
+    if (w->polling) {
+        uint64_t one = 1;
+        if (write(w->pool->io_wake_fd, &one, sizeof(one)) < 0) {}
     }
-
-    message_t message;
-    message.message_type = MSG_HELLO;
-    message.data = (void*)(-1);
-    message.nbytes = sizeof(message.data);
-    send_message(0, message);
-
-    //zapisuje id pierwszego aktora
-    *actor = (actor_id_t)(0);
-    
-    return 0;
+    else
+        pthread_cond_signal(&w->park);
 }
 
-void free_queue(queue_t* q) {
-    while (!queue_empty(q))
-        queue_get(q);
-    free(q);
+void unpark(worker_t* w) {
+    pthread_mutex_lock(&w->park_lock);
+    w->wakeup = true;
+    signal_worker(w);
+    pthread_mutex_unlock(&w->park_lock);
 }
 
-void free_mqueue(mqueue_t* q) {
-    while (!mqueue_empty(q))
-        mqueue_get(q);
-    free(q);
+bool poll_io(struct actor_system* pool, int timeout);
+
+/* jak park, ale najwyżej do chwili deadline (clock_ns) albo szturchnięcia, a gdy
+aktorzy obserwują deskryptory - w epoll_wait, do ich gotowości; true, gdy
+obudził mnie unpark (wtedy ktoś zdjął mnie już ze stosu śpiących) */
+bool park_until(worker_t* w, uint64_t deadline) {
+    struct timespec ts = { .tv_sec = deadline / 1000000000ull, .tv_nsec = deadline % 1000000000ull };
+    pthread_mutex_lock(&w->park_lock);
+    if (atomic_load(&w->pool->io_watched) > 0) {
+        if (!w->wakeup && !w->kicked) {
+            //milisekundy epoll_wait zaokrąglam w górę - wcześniejsza pobudka nic by nie dała
+            int timeout = -1;
+            if (deadline != UINT64_MAX) {
+                uint64_t now = clock_ns();
+                uint64_t ms = deadline > now ? (deadline - now + 999999) / 1000000 : 0;
+                timeout = ms < INT_MAX ? (int)ms : INT_MAX;
+            }
+            w->polling = true;
+            pthread_mutex_unlock(&w->park_lock);
+            poll_io(w->pool, timeout);
+            pthread_mutex_lock(&w->park_lock);
+            w->polling = false;
+        }
+    }
+    else {
+        while (!w->wakeup && !w->kicked) {
+            if (deadline == UINT64_MAX)
+                pthread_cond_wait(&w->park, &w->park_lock);
+            else if (pthread_cond_timedwait(&w->park, &w->park_lock, &ts) == ETIMEDOUT)
+                break;
+        }
+    }
+    bool woken = w->wakeup;
+    w->wakeup = false;
+    w->kicked = false;
+    pthread_mutex_unlock(&w->park_lock);
+    return woken;
 }
 
-void destroy_actor(actor_t* act) {
-    if (act != NULL) {
-        free_mqueue(act->mailbox);
-        pthread_mutex_destroy(&act->lock);
+//zdejmuje wątek ze stosu śpiących; false, gdy już go tam nie ma - trzeba mieć mutex od puli
+bool unlist_idle(pool_t* pool, worker_t* w) {
+    int n = atomic_load_explicit(&pool->idle_workers, memory_order_relaxed);
+    for (int i = 0; i < n; i++) {
+        if (pool->idle[i] == w) {
+            pool->idle[i] = pool->idle[n - 1];
+            atomic_fetch_sub(&pool->idle_workers, 1);
+            return true;
+        }
     }
-    free(act);
+    return false;
 }
 
-//zwraca coś niezerowego jak coś się wysypie
-int actor_system_destroy() {
-    int out = 0, err = 0;
+//budzi do k śpiących wątków, o ile jakieś śpią
+void wake_workers(pool_t* pool, size_t k) {
+    //para z atomic_fetch_add w find_actor - albo zobaczymy śpiący wątek,
+    //albo on zobaczy dodanego przez nas aktora
+    atomic_thread_fence(memory_order_seq_cst);
+    size_t searching = atomic_load_explicit(&pool->searching, memory_order_relaxed);
+    if (k <= searching || atomic_load_explicit(&pool->idle_workers, memory_order_relaxed) == 0)
+        return;
+    k -= searching;
 
-    //global_pool->working = false; //to żeby wątki się w ogóle zakończyły    
-    //pthread_cond_signal(&global_pool->passive);
+    worker_t* woken[k < pool->nworkers ? k : pool->nworkers];
+    size_t n = 0;
 
-    void* retval;
-    for (int i = 0; i < POOL_SIZE; i++) {
-        //printf("kończę wątek\n");
-        if ((err = pthread_join(global_pool->workers[i], &retval)) != 0)
-            out = err;
-        //pthread_attr_destroy(global_pool->workers[i]);
+    lock_pool(pool);
+    while (n < sizeof(woken) / sizeof(woken[0]) && atomic_load_explicit(&pool->idle_workers, memory_order_relaxed) > 0) {
+        woken[n++] = pool->idle[atomic_fetch_sub(&pool->idle_workers, 1) - 1];
+        atomic_fetch_add(&pool->searching, 1);
     }
+    if (pthread_mutex_unlock(&pool->mutex) != 0) {}
 
-    //free(retval); //nie wiem po co to
-
-    pthread_cond_destroy(&global_pool->passive);
+    for (size_t i = 0; i < n; i++)
+        unpark(woken[i]);
+}
 
-    for (size_t i = 0; i < global_pool->number; i++) {
-        destroy_actor(global_pool->actors[i]);
+//budzi wszystkie śpiące wątki - trzeba mieć mutex od puli
+void wake_all_workers(pool_t* pool) {
+    while (atomic_load_explicit(&pool->idle_workers, memory_order_relaxed) > 0) {
+        atomic_fetch_add(&pool->searching, 1);
+        unpark(pool->idle[atomic_fetch_sub(&pool->idle_workers, 1) - 1]);
     }
-
-    //czyści kolejkę gotowych
-    free_queue(global_pool->queue);
-
-    //czyści tablicę aktorów
-    free(global_pool->actors);
-
-    if ((err = pthread_mutex_destroy(&global_pool->mutex)) != 0)
-        out = err;
-
-    free(global_pool);
-    global_pool = NULL;
-    return out; //0 jeśli udało się zniczczyć wszystkie mutexy
 }
 
-void actor_system_join(actor_id_t actor) {
-    if (global_pool == NULL || actor < 0 || (size_t)(actor) >= global_pool->number)
+//dodaje aktora do kolejki gotowych do działania (jego klasy), nie budząc wątków
+void enqueue_ready(pool_t* pool, actor_id_t id) {
+    //aktor z niepustą skrzynką nie zostanie odzyskany, więc wolno go czytać
+    actor_t* actor = actor_at(pool, id);
+    int c = actor->sched_class;
+#ifdef CACTI_STATS
+    actor->ready_since = clock_ns();
+#endif
+
+    //z wnętrza puli wrzucamy do własnej kolejki, bez mutexa
+    if (my_worker != NULL && my_worker->pool == pool && runq_push(&my_worker->runq[c], id))
         return;
 
-    actor_system_destroy(global_pool);
+    //zabieram mutex od całej puli
+    lock_pool(pool);
+
+    //dodaję aktora do listy gotowych do działania
+    queue_add(pool->queue[c], id);
+    atomic_fetch_add(&pool->queued[c], 1);
+#ifdef CACTI_STATS
+    size_t total = 0;
+    for (int k = 0; k < ACTOR_CLASSES; k++)
+        total += (size_t)pool->queue[k]->len;
+    if (total > pool->queue_high_water)
+        pool->queue_high_water = total;
+#endif
+
+    //oddaję mutex od całej puli
+    if (pthread_mutex_unlock(&pool->mutex) != 0) {}
 }
 
-//zakładam, że w momencie wywoływania tego mam mutex???
-int send_message(actor_id_t actor, message_t message) {
-    //być może tutaj jeszcze trzeba zabrać mutex od całej puli
+/* dodaje aktora do kolejki gotowych do działania i budzi ewentualnie wątek;
+system przypięty - od dodania aktora do obudzenia wątków aktor może skończyć,
+a z nim cały system; nie ma go już - nie ma kogo uszeregować */
+void schedule(actor_id_t id) {
+    pool_t* pool = pin_actor_system(id);
+    if (pool == NULL)
+        return;
+    enqueue_ready(pool, id);
+    wake_workers(pool, 1);
+    unpin_system(pool);
+}
 
-    //taki aktor nie istnieje
-    if (global_pool == NULL || actor < 0 || global_pool->number <= (size_t)(actor))
-        return -2;
+//zabiera aktora klasy c z kolejki globalnej
+actor_id_t global_get(pool_t* pool, int c) {
+    if (atomic_load_explicit(&pool->queued[c], memory_order_relaxed) == 0)
+        return -1;
 
-    //zabieram mutex od tego aktora
-    if (pthread_mutex_lock(&global_pool->actors[actor]->lock) != 0) {}
+    lock_pool(pool);
+#ifdef CACTI_STATS
+    uint64_t since = pool->queue[c]->first != NULL ? pool->queue[c]->first->since : 0;
+#endif
+    actor_id_t id = queue_get(pool->queue[c]);
+    if (id >= 0)
+        atomic_fetch_sub(&pool->queued[c], 1);
+    if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+#ifdef CACTI_STATS
+    if (id >= 0 && my_worker != NULL) {
+        STAT_ADD(my_worker, global_taken, 1);
+        STAT_ADD(my_worker, global_wait_ns, clock_ns() - since);
+    }
+#endif
+    return id;
+}
 
-    //aktor jest martwy - nie odbiera komunikatów
-    if (global_pool->actors[actor]->dead) {
-        //zwalniam mutex od tego aktora
-        if (pthread_mutex_unlock(&global_pool->actors[actor]->lock) != 0) {}
-        return -1;
+/* czy wolno już zabrać jedynego aktora z kolejki q - czeka tam co najmniej
+steal_grace_ns; obserwuję jedną kolejkę naraz (nową dopiero, gdy w poprzedniej
+aktor ruszył), więc nawet przy wielu zajętych wątkach któryś w końcu oddam */
+bool lone_ripe(worker_t* me, runq_t* q) {
+    size_t h = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (me->lone_q == q && me->lone_head == h)
+        return clock_ns() - me->lone_since >= me->pool->steal_grace_ns;
+    if (me->lone_q == NULL || atomic_load_explicit(&me->lone_q->head, memory_order_relaxed) != me->lone_head) {
+        me->lone_q = q;
+        me->lone_head = h;
+        me->lone_since = clock_ns();
     }
+    return false;
+}
 
-    //aktor ma pełną kolejkę komunikatów
-    if (global_pool->actors[actor]->mailbox->len == ACTOR_QUEUE_LIMIT) {
-        //zwalniam mutex od tego aktora
-        //fprintf(stderr, "kolejka aktora %ld przepełniona\n", actor);
-        if (pthread_mutex_unlock(&global_pool->actors[actor]->lock) != 0) {}
-        return -3;
+/* próbuje ukraść aktorów klasy c innym wątkom, zaczynając od losowego; aktor
+gotowy zostaje, jeśli się da, na wątku, który go obudził (także dziecko przy
+MSG_SPAWN - na wątku rodzica), więc jedynego w kolejce nie zabieram od razu */
+actor_id_t steal(worker_t* me, int c) {
+    pool_t* pool = me->pool;
+    size_t start = rand_r(&me->seed) % pool->nworkers;
+    for (size_t i = 0; i < pool->nworkers; i++) {
+        worker_t* victim = &pool->workers[(start + i) % pool->nworkers];
+        if (victim == me)
+            continue;
+        runq_t* q = &victim->runq[c];
+        if (pool->steal_grace_ns > 0
+            && atomic_load_explicit(&q->tail, memory_order_acquire) - atomic_load_explicit(&q->head, memory_order_acquire) == 1
+            && !lone_ripe(me, q))
+            continue;
+        actor_id_t id = runq_steal(q, &me->runq[c]);
+        if (id >= 0) {
+            STAT_ADD(me, steals, 1);
+            return id;
+        }
     }
+    return -1;
+}
 
-    //ten aktor miał pustą listę komunikatów
-    if (mqueue_empty(global_pool->actors[actor]->mailbox)) {
+//czy gdziekolwiek czeka aktor gotowy do działania
+bool work_available(pool_t* pool) {
+    for (int c = 0; c < ACTOR_CLASSES; c++)
+        if (atomic_load(&pool->queued[c]) > 0)
+            return true;
+    for (size_t i = 0; i < pool->nworkers; i++)
+        for (int c = 0; c < ACTOR_CLASSES; c++)
+            if (!runq_empty(&pool->workers[i].runq[c]))
+                return true;
+    return false;
+}
 
-        if (global_pool->actors[actor]->working == false) {
+//czy wszyscy aktorzy umarli - trzeba mieć mutex od puli
+bool pool_finished(pool_t* pool) {
+    return (atomic_load(&pool->live_actors) == 0 && atomic_load(&pool->number) != 0) || atomic_load(&pool->stopping);
+}
 
-            //zabieram mutex od całej puli
-            if (pthread_mutex_lock(&global_pool->mutex) != 0) {}
+//budzi naraz wszystkie śpiące wątki, żeby się skończyły, i czekających na koniec - trzeba mieć mutex od puli
+void finish_pool(pool_t* pool) {
+    wake_all_workers(pool);
+    pthread_cond_broadcast(&pool->end);
+}
 
-            //dodeję aktora do listy gotowych do działania   
-            queue_add(global_pool->queue, actor);
-            //fprintf(stderr, "send_message dodaje aktora %ld do kolejki\n", actor);
-            //assert(global_pool->queue->last != NULL);
+//ustawia timer_next według koła - trzeba mieć timer_lock
+void update_timer_next(pool_t* pool) {
+    uint64_t tick = wheel_next(&pool->wheel);
+    atomic_store(&pool->timer_next, tick == UINT64_MAX ? UINT64_MAX : pool->timer_epoch + tick * TIMER_TICK_NS);
+}
 
-            //budzę czekający ewentualnie wątek
-            pthread_cond_signal(&global_pool->passive);
+//zegar odpalił; komunikat do martwego przepada, a okresowy zegar do niego się kończy
+bool fire_timer(void* arg, actor_id_t to, message_t message) {
+    (void)arg;
+    int err = send_message(to, message);
+    return err != -1 && err != -2;
+}
 
-            //oddaję mutex od całej puli
-            if (pthread_mutex_unlock(&global_pool->mutex) != 0) {}    
+//odpala zegary, których czas minął (wywołują wątki puli, szukając pracy)
+void run_timers(pool_t* pool) {
+    uint64_t next = atomic_load_explicit(&pool->timer_next, memory_order_relaxed);
+    if (next == UINT64_MAX)
+        return;
+    uint64_t now = clock_ns();
+    if (now < next)
+        return;
+    //zajętym kołem zajmuje się już ktoś inny (albo za chwilę zajmie)
+    if (pthread_mutex_trylock(&pool->timer_lock) != 0)
+        return;
+    wheel_advance(&pool->wheel, (now - pool->timer_epoch) / TIMER_TICK_NS, fire_timer, pool);
+    update_timer_next(pool);
+    pthread_mutex_unlock(&pool->timer_lock);
+}
+
+/* zegar stał się najbliższym albo przybył obserwowany deskryptor - pilnujący musi
+przestawić budzik (albo zacząć czekać w epoll_wait), a jeśli nikt nie pilnuje,
+budzę wątek (zaśnie znowu już jako pilnujący) */
+void kick_poller(pool_t* pool) {
+    worker_t* keeper = atomic_load(&pool->poller);
+    if (keeper == NULL) {
+        wake_workers(pool, 1);
+        return;
+    }
+    pthread_mutex_lock(&keeper->park_lock);
+    keeper->kicked = true;
+    signal_worker(keeper);
+    pthread_mutex_unlock(&keeper->park_lock);
+}
+
+//obserwacja deskryptora przez aktora (io_watch)
+typedef struct io_watch {
+    actor_id_t actor;
+    message_type_t message_type;
+    uint32_t gen; //zmienia się przy każdym io_unwatch - gotowość starej obserwacji przepada
+    bool used;
+} io_watch_t;
+
+//zdarzenia w jednym epoll_wait
+#define IO_EVENTS 64
+//znacznik pobudki (io_wake_fd) w epoll - deskryptory mają w danych pokolenie i numer
+#define IO_WAKE UINT64_MAX
+
+static inline uint32_t io_epoll_events(unsigned events) {
+    return ((events & IO_READ) ? EPOLLIN | EPOLLRDHUP : 0) | ((events & IO_WRITE) ? EPOLLOUT : 0) | EPOLLONESHOT;
+}
+
+static inline unsigned io_ready_events(uint32_t events) {
+    return ((events & EPOLLIN) ? IO_READ : 0) | ((events & EPOLLOUT) ? IO_WRITE : 0)
+        | ((events & (EPOLLHUP | EPOLLRDHUP)) ? IO_HUP : 0) | ((events & EPOLLERR) ? IO_ERROR : 0);
+}
+
+int deliver(actor_id_t actor, const message_t* messages, size_t n, bool copy, shared_buf_t* shared, bool bounded, const ask_token_t* ask, bool* ready);
+
+/* odbiera gotowość deskryptorów (czekając najwyżej timeout ms, -1 - bez końca)
+i rozsyła ją aktorom; zwraca, czy cokolwiek rozesłał */
+bool poll_io(pool_t* pool, int timeout) {
+    struct epoll_event events[IO_EVENTS];
+    int n = epoll_wait(pool->epoll_fd, events, IO_EVENTS, timeout);
+    bool any = false;
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.u64 == IO_WAKE) {
+            uint64_t count;
+            if (read(pool->io_wake_fd, &count, sizeof(count)) < 0) {}
+            continue;
         }
-        
+        int fd = (int)(uint32_t)events[i].data.u64;
+        uint32_t gen = (uint32_t)(events[i].data.u64 >> 32);
+
+        pthread_mutex_lock(&pool->io_lock);
+        io_watch_t* watch = (size_t)fd < pool->io_capacity ? &pool->io_watches[fd] : NULL;
+        bool live = watch != NULL && watch->used && watch->gen == gen;
+        message_t message = { .message_type = live ? watch->message_type : 0,
+            .nbytes = io_ready_events(events[i].events), .data = (void*)(intptr_t)fd };
+        actor_id_t actor = live ? watch->actor : -1;
+        pthread_mutex_unlock(&pool->io_lock);
+        if (!live)
+            continue;
+
+        /* obserwacja jest jednorazowa (do io_rearm), więc takich komunikatów jest
+        w skrzynce najwyżej tyle, co obserwacji - przyjmuję je ponad limit */
+        bool ready;
+        if (deliver(actor, &message, 1, false, NULL, false, NULL, &ready) == 1 && ready)
+            schedule(actor);
+        any = true;
     }
-    
-    mqueue_add(global_pool->actors[actor]->mailbox, message);
-    //assert(global_pool->actors[actor]->mailbox->last != NULL);
-    
-    //oddaję mutex od tego aktora   
-    if (pthread_mutex_unlock(&global_pool->actors[actor]->lock) != 0) {}
+    return any;
+}
+
+/* szuka aktora do uruchomienia, nie zasypiając - klasy w kolejności z class_order,
+najpierw bez kradzieży, potem kradnąc */
+actor_id_t try_find_actor(worker_t* me) {
+    pool_t* pool = me->pool;
+    actor_id_t id;
+    const int* order = class_order(++me->ticks);
+
+    if (me->ticks % GLOBAL_QUEUE_INTERVAL == 0)
+        for (int i = 0; i < ACTOR_CLASSES; i++)
+            if ((id = global_get(pool, order[i])) >= 0)
+                return id;
+    for (int i = 0; i < ACTOR_CLASSES; i++) {
+        if ((id = runq_pop(&me->runq[order[i]])) >= 0)
+            return id;
+        if ((id = global_get(pool, order[i])) >= 0)
+            return id;
+    }
+    for (int i = 0; i < ACTOR_CLASSES; i++)
+        if ((id = steal(me, order[i])) >= 0)
+            return id;
+    return -1;
+}
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+//czeka aktywnie na pracę co najwyżej pool->spin_ns; zwraca, czy się pojawiła
+bool spin_for_work(pool_t* pool) {
+    if (pool->spin_ns == 0)
+        return false;
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        for (int i = 0; i < 64; i++)
+            cpu_relax();
+        if (work_available(pool))
+            return true;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < pool->spin_ns);
+    return false;
+}
+
+//szuka aktora do uruchomienia; zwraca -1, gdy system skończył pracę
+actor_id_t find_actor(worker_t* me) {
+    pool_t* pool = me->pool;
+    actor_id_t id;
+
+#ifdef CACTI_STATS
+    //czas bezczynności liczę dopiero, gdy pracy nie ma od razu
+    uint64_t idle_since = 0;
+#endif
+
+    //zatrzymany system kończy się od razu, bez aktorów czekających w kolejkach
+    if (atomic_load_explicit(&pool->stopping, memory_order_relaxed))
+        return -1;
+
+    atomic_fetch_add(&pool->searching, 1);
+    while (true) {
+        //odpalone zegary mogą dać pracę
+        run_timers(pool);
+        //gotowość deskryptorów sprawdzam też przy pracy, co GLOBAL_QUEUE_INTERVAL aktywacji
+        bool io = atomic_load_explicit(&pool->io_watched, memory_order_relaxed) > 0;
+        if (io && me->ticks % GLOBAL_QUEUE_INTERVAL == 0)
+            poll_io(pool, 0);
+        if ((id = try_find_actor(me)) >= 0)
+            break;
+#ifdef CACTI_STATS
+        if (idle_since == 0)
+            idle_since = clock_ns();
+#endif
+        if (io && poll_io(pool, 0))
+            continue;
+        //praca często przychodzi zaraz - zanim zasnę, chwilę na nią czekam
+        if (spin_for_work(pool))
+            continue;
+
+        //nie ma nic do roboty - przestaję szukać i zapisuję się na stos śpiących
+        lock_pool(pool);
+
+        atomic_fetch_sub(&pool->searching, 1);
+        if (pool_finished(pool)) {
+            pthread_mutex_unlock(&pool->mutex);
+            return -1;
+        }
+
+        pool->idle[atomic_load_explicit(&pool->idle_workers, memory_order_relaxed)] = me;
+        atomic_fetch_add(&pool->idle_workers, 1);
+
+        if (work_available(pool)) {
+            //od zapisania się nikt nie brał mutexa, więc nadal jestem na szczycie stosu
+            atomic_fetch_sub(&pool->idle_workers, 1);
+            atomic_fetch_add(&pool->searching, 1);
+            if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+            continue;
+        }
+
+        /* jeden śpiący pilnuje zegarów i deskryptorów - zapisany na stosie sprawdzam,
+        czy są (para z kick_poller: albo widzę nowy zegar lub deskryptor, albo
+        nastawiający widzi mnie) */
+        uint64_t deadline = atomic_load(&pool->timer_next);
+        worker_t* keeper = NULL;
+        bool keeping = (deadline != UINT64_MAX || atomic_load(&pool->io_watched) > 0)
+            && atomic_compare_exchange_strong(&pool->poller, &keeper, me);
+        if (keeping)
+            deadline = atomic_load(&pool->timer_next);
+
+        if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+
+        //budzi mnie wake_workers, który zdjął mnie ze stosu i policzył jako szukający
+        STAT_ADD(me, parks, 1);
+        if (!keeping) {
+            park(me);
+            continue;
+        }
+        bool woken = park_until(me, deadline);
+        atomic_store(&pool->poller, NULL);
+        if (woken)
+            continue;
+        //obudziłem się sam - schodzę ze stosu, chyba że ktoś już mnie zdjął i zaraz obudzi
+        lock_pool(pool);
+        bool listed = unlist_idle(pool, me);
+        if (listed)
+            atomic_fetch_add(&pool->searching, 1);
+        if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+        if (!listed)
+            park(me);
+    }
+    atomic_fetch_sub(&pool->searching, 1);
+#ifdef CACTI_STATS
+    if (idle_since != 0)
+        STAT_ADD(me, idle_ns, clock_ns() - idle_since);
+#endif
+    return id;
+}
+
+//obsługuje komunikat systemowy albo wywołuje odpowiedni prompt aktora
+void handle_message(pool_t* pool, actor_t* actor, message_t message) {
+    if (message.message_type == MSG_GODIE) {
+        //od teraz aktor nie przyjmuje komunikatów; te już przyjęte jeszcze przetworzy
+        mailbox_kill(&actor->mailbox);
+        TRACE(pool, TRACE_GODIE, actor->id, -1, 0, 0);
+    }
+    else if (message.message_type == MSG_SPAWN) {
+        //zapisuję się przed sprawdzeniem - para z godie_all (albo ja widzę zamykanie, albo ono mnie)
+        atomic_fetch_add(&pool->spawning, 1);
+        if (atomic_load(&pool->draining)) {
+            atomic_fetch_sub(&pool->spawning, 1);
+            return;
+        }
+        actor_id_t id = add_actor(pool, message.data); //id tego, do którego wysyłam
+        atomic_fetch_sub(&pool->spawning, 1);
+        TRACE(pool, TRACE_SPAWN, actor->id, id, 0, 0);
+        message_t hello;
+        hello.message_type = MSG_HELLO;
+        hello.data = (void*)(actor->id);
+        hello.nbytes = sizeof(hello.data);
+
+        send_message(id, hello);
+    }
+    //porównanie bez znaku odrzuca też ujemne typy
+    else if ((size_t)message.message_type < actor->role->nprompts) {
+        actor->role->prompts[message.message_type](&actor->state, message.nbytes, message.data);
+    }
+}
+
+//wysłanie wstrzymane przez send_message_wait (odbiorca miał pełną skrzynkę)
+typedef struct pending_send {
+    actor_id_t to;
+    message_t message;
+    struct pending_send* next;
+} pending_send_t;
+
+//na miejsce w skrzynkach czekają tu wątki spoza puli (patrz send_message_wait)
+pthread_mutex_t space_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t space_freed = PTHREAD_COND_INITIALIZER;
+
+/* dostarcza po kolei wstrzymane wysłania aktora; false, gdy któryś odbiorca wciąż
+ma pełną skrzynkę (to wysłanie i następne zostają); komunikat do martwego przepada */
+bool flush_outgoing(actor_t* actor) {
+    while (actor->outgoing != NULL) {
+        pending_send_t* p = actor->outgoing;
+        if (send_message(p->to, p->message) == -3)
+            return false;
+        actor->outgoing = p->next;
+        free(p);
+    }
+    actor->outgoing_tail = &actor->outgoing;
+    return true;
+}
+
+//uszeregowuje wszystkich aktorów czekających na miejsce w skrzynce target (z dowolnych systemów)
+void wake_waiters(actor_t* target) {
+    actor_t* waiter = atomic_exchange_explicit(&target->waiters, NULL, memory_order_seq_cst);
+    while (waiter != NULL) {
+        //następnego czytam przed uszeregowaniem - potem aktor może znów czekać
+        actor_t* next = waiter->next_waiter;
+        schedule(waiter->id);
+        waiter = next;
+    }
+}
+
+/* wywołuje wątek aktora po zwolnieniu miejsca w jego skrzynce; odczyty sekwencyjnie
+spójne, w parze z mailbox_full u czekających (któraś strona zawsze zauważy drugą) */
+static inline void wake_senders(actor_t* actor) {
+    if (atomic_load_explicit(&actor->waiters, memory_order_seq_cst) != NULL)
+        wake_waiters(actor);
+    if (atomic_load_explicit(&actor->blocked_senders, memory_order_seq_cst) > 0) {
+        if (pthread_mutex_lock(&space_lock) != 0) {}
+        pthread_cond_broadcast(&space_freed);
+        if (pthread_mutex_unlock(&space_lock) != 0) {}
+    }
+}
+
+/* wstrzymany aktor czeka na miejsce u odbiorcy pierwszego wstrzymanego wysłania;
+jeśli miejsce zwolniło się, zanim się zapisał, budzi czekających sam */
+void park_sender(actor_t* actor) {
+    //po zapisaniu się aktor może już działać na innym wątku - potem go nie czytam
+    actor_id_t to = actor->outgoing->to;
+    pool_t* target_pool = pin_actor_system(to);
+    actor_t* target = target_pool != NULL ? actor_at(target_pool, to) : NULL;
+    if (target == NULL) {
+        unpin_system(target_pool);
+        schedule(actor->id);
+        return;
+    }
+    actor->next_waiter = atomic_load_explicit(&target->waiters, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&target->waiters, &actor->next_waiter, actor,
+                memory_order_seq_cst, memory_order_relaxed)) {}
+    if (!mailbox_full(&target->mailbox, actor_generation(to), target->mailbox_limit))
+        wake_waiters(target);
+    unpin_system(target_pool);
+}
+
+//tyle wolnych korutyn (ze stosami) wątek trzyma na później
+#define COROUTINE_CACHE 16
+
+/* korutyna wykonuje prompty aktorów korutynowych, po jednym komunikacie naraz,
+i wraca do wątku, gdy prompt się skończy albo zacznie czekać w ask_message -
+wtedy zostaje przy aktorze, a wznowić ją może inny wątek puli */
+typedef struct coroutine {
+    co_context_t context;
+    co_context_t* host; //kontekst wątku, który ją ostatnio uruchomił
+    void* stack;
+    pool_t* pool;
+    actor_t* actor;
+    //obsługiwany komunikat (węzeł oddaję po skończonym prompcie) i odpowiedź na pytanie
+    mnode_t* node;
+    message_t message;
+    message_t answer;
+    int status; //wynik ask_message: 0 - jest odpowiedź, -2 - pytanie przepadło
+    bool finished;
+    struct coroutine* next; //na liście wolnych wątku
+} coroutine_t;
+
+/* kończy pytanie z ask_message - pytający wróci z niego ze statusem (0 - z
+odpowiedzią); kończy tylko pierwszy; -1 - pytanie już zakończone, -2 -
+pytający (albo jego system) nie żyje */
+int complete_ask(ask_token_t ask, message_t answer, int status) {
+    pool_t* pool = pin_actor_system(ask.asker);
+    actor_t* asker = pool != NULL ? actor_at(pool, ask.asker) : NULL;
+    if (asker == NULL) {
+        unpin_system(pool);
+        return -2;
+    }
+
+    //numer pytania przestaje pasować
+    uint32_t seq = ask.seq;
+    int out = -1;
+    if (atomic_compare_exchange_strong_explicit(&asker->ask_seq, &seq, seq + 1,
+            memory_order_relaxed, memory_order_relaxed)) {
+        asker->co->answer = answer;
+        asker->co->status = status;
+        if (atomic_fetch_sub_explicit(&asker->ask_pending, 1, memory_order_acq_rel) == 1)
+            schedule(ask.asker);
+        out = 0;
+    }
+    unpin_system(pool);
+    return out;
+}
+
+/* pytanie, na które nikt już nie odpowie: prompt wrócił bez reply_message (także
+komunikat spoza roli) albo odbiorca go nie przetworzy - ask_message zwraca -2 */
+static inline void drop_ask(ask_token_t* ask) {
+    if (ask->asker < 0)
+        return;
+    complete_ask(*ask, (message_t){ .message_type = 0 }, -2);
+    ask->asker = -1;
+}
+
+/* pętla korutyny; po przełączeniu może działać na innym wątku niż przed nim,
+więc nie czyta zmiennych wątku (wywoływane prompty czytają je od nowa) */
+void coroutine_main(void* arg) {
+    coroutine_t* co = (coroutine_t*)arg;
+    while (true) {
+        handle_message(co->pool, co->actor, co->message);
+        co->finished = true;
+        co_swap(&co->context, co->host);
+    }
+}
+
+//wolna korutyna wątku albo nowa; NULL, gdy zabrakło pamięci
+coroutine_t* coroutine_get(worker_t* me) {
+    coroutine_t* co = me->coroutines;
+    if (co != NULL) {
+        me->coroutines = co->next;
+        me->ncoroutines--;
+        return co;
+    }
+    co = (coroutine_t*)malloc(sizeof(coroutine_t));
+    if (co == NULL)
+        return NULL;
+    co->stack = co_stack_alloc(COROUTINE_STACK_SIZE);
+    if (co->stack == NULL) {
+        free(co);
+        return NULL;
+    }
+    co_make(&co->context, co->stack, COROUTINE_STACK_SIZE, coroutine_main, co);
+    return co;
+}
+
+void coroutine_free(coroutine_t* co) {
+    co_destroy(&co->context);
+    co_stack_free(co->stack, COROUTINE_STACK_SIZE);
+    free(co);
+}
+
+//korutyna po skończonym prompcie - stoi w pętli, gotowa na następny
+void coroutine_put(worker_t* me, coroutine_t* co) {
+    if (me->ncoroutines >= COROUTINE_CACHE) {
+        coroutine_free(co);
+        return;
+    }
+    co->next = me->coroutines;
+    me->coroutines = co;
+    me->ncoroutines++;
+}
+
+/* przełącza wątek na korutynę aktora, aż prompt się skończy (true - sprząta po
+nim) albo zacznie czekać na odpowiedź (false - korutyna i węzeł zostają) */
+bool enter_coroutine(worker_t* me, actor_t* actor) {
+    coroutine_t* co = actor->co;
+    co->host = &me->host;
+    co->finished = false;
+    co_swap(&me->host, &co->context);
+    if (!co->finished)
+        return false;
+    drop_ask(&actor->asked_by);
+    actor->co = NULL;
+    message_done(co->node);
+    coroutine_put(me, co);
+    return true;
+}
+
+/* obsługuje komunikat ze skrzynki: prompty aktorów korutynowych na korutynie;
+false, gdy prompt czeka w ask_message */
+bool run_message(worker_t* me, actor_t* actor, mnode_t* node) {
+    actor->asked_by = *mnode_ask(node);
+    message_t message = node->val;
+    coroutine_t* co = NULL;
+    if (actor->role->coroutine && message.message_type != MSG_GODIE && message.message_type != MSG_SPAWN)
+        co = coroutine_get(me);
+    //bez korutyny (także gdy zabrakło na nią pamięci) prompt działa na stosie wątku, a ask_message zwraca -5
+    if (co == NULL) {
+        handle_message(me->pool, actor, message);
+        drop_ask(&actor->asked_by);
+        message_done(node);
+        return true;
+    }
+    co->pool = me->pool;
+    co->actor = actor;
+    co->node = node;
+    co->message = message;
+    actor->co = co;
+    return enter_coroutine(me, actor);
+}
+
+//wątek oddaje aktora czekającego na odpowiedź; jeśli ta już przyszła, sam go uszeregowuje
+void await_answer(actor_t* actor) {
+    actor_id_t id = actor->id;
+    if (atomic_fetch_sub_explicit(&actor->ask_pending, 1, memory_order_acq_rel) == 1)
+        schedule(id);
+}
+
+void* work(void* data) { //argument to wskaźnik na strukturę wątku w puli
+
+    worker_t* me = (worker_t*)data;
+    pool_t* pool = me->pool;
+    my_worker = me;
+   
+    while (true) {
+
+        my_actor_id = find_actor(me);
+        if (my_actor_id < 0) {
+            mnode_cache_flush();
+            while (me->coroutines != NULL) {
+                coroutine_t* co = me->coroutines;
+                me->coroutines = co->next;
+                coroutine_free(co);
+            }
+            return NULL;
+        }
+
+        actor_t* actor = actor_at(pool, my_actor_id);
+        TRACE(pool, TRACE_BEGIN, my_actor_id, -1, 0, 0);
+#ifdef CACTI_STATS
+        record_wait(me, actor->sched_class, clock_ns() - actor->ready_since);
+        if (actor->last_worker != me->index && actor->last_worker != SIZE_MAX)
+            STAT_ADD(me, migrations, 1);
+        actor->last_worker = me->index;
+#endif
+
+        /* wstrzymany aktor (send_message_wait) trzyma w liczniku skrzynki jeden
+        komunikat bez węzła - nikt inny go nie uszereguje; wznowiony najpierw
+        dostarcza swoje wysłania, a ten komunikat odlicza z pierwszą paczką */
+        uint64_t held = 0;
+        //prompt czekający w ask_message (też trzyma swój komunikat) dostał odpowiedź
+        if (actor->co != NULL) {
+            if (!enter_coroutine(me, actor)) {
+                my_actor_id = -1;
+                await_answer(actor);
+                continue;
+            }
+            held = 1;
+        }
+        if (actor->outgoing != NULL) {
+            if (!flush_outgoing(actor)) {
+                my_actor_id = -1;
+                park_sender(actor);
+                continue;
+            }
+            held = 1;
+        }
+
+        /* aktor jest nasz, dopóki licznik komunikatów nie spadnie do zera - zabieramy
+        paczkę naraz i odliczamy ją jedną operacją; jeśli w międzyczasie przyszła nowa
+        poczta, działamy dalej, aż wyczerpie się budżet albo aktor się wstrzyma */
+        uint64_t budget = ACTOR_FAIRNESS_BUDGET;
+        uint64_t left;
+        bool suspended = false;
+        bool awaiting = false;
+        do {
+            uint64_t tasks = mailbox_count(&actor->mailbox) - held;
+            if (tasks > ACTOR_BATCH_SIZE)
+                tasks = ACTOR_BATCH_SIZE;
+            if (tasks > budget)
+                tasks = budget;
+
+            //działa z tym aktorem (w zatrzymanym systemie tylko kończy bieżący komunikat)
+            uint64_t i = 0;
+            while (i < tasks && !suspended && !atomic_load_explicit(&pool->stopping, memory_order_relaxed)) {
+                //zabieram komunikat z listy; węzeł oddaję dopiero po obsłużeniu,
+                //bo ładunek wysłany przez send_message_inline jest w nim
+                mnode_t* node = mailbox_pop_wait(&actor->mailbox);
+                //aktywację łączę z wysłaniem jej pierwszego komunikatu
+                if (pool->tracing && i == 0 && budget == ACTOR_FAIRNESS_BUDGET && *mnode_flow(node) != 0)
+                    trace_event(pool, TRACE_RECV, my_actor_id, -1, *mnode_flow(node), 0);
+                awaiting = !run_message(me, actor, node);
+                i++;
+                suspended = awaiting || actor->outgoing != NULL;
+            }
+
+            budget -= i;
+            //wstrzymany zostawia w liczniku ostatni obsłużony komunikat
+            left = mailbox_release(&actor->mailbox, i + held - suspended);
+            held = 0;
+            wake_senders(actor);
+        } while (!suspended && (left & MAILBOX_COUNT_MASK) > 0 && budget > 0
+                 && !atomic_load_explicit(&pool->stopping, memory_order_relaxed));
+
+        TRACE(pool, TRACE_END, actor->id, -1, 0, (uint32_t)(ACTOR_FAIRNESS_BUDGET - budget));
+        STAT_ADD(me, activations, 1);
+        STAT_ADD(me, messages, ACTOR_FAIRNESS_BUDGET - budget);
+#ifdef CACTI_STATS
+        stat_add(&actor->messages, ACTOR_FAIRNESS_BUDGET - budget);
+#endif
+
+        //a teraz już nie mam aktora
+        my_actor_id = -1;
+
+        if (awaiting) {
+            //aktor wróci do kolejki gotowych z odpowiedzią
+            await_answer(actor);
+        }
+        else if (suspended) {
+            //aktor wróci do kolejki gotowych, gdy odbiorca zrobi miejsce
+            park_sender(actor);
+        }
+        //doszły nam jeszcze nowe wiadomości do przetworzenia
+        else if ((left & MAILBOX_COUNT_MASK) > 0) {
+            //wrzucam aktora ponownie do kolejki (swojej, więc bez mutexa puli)
+            schedule(actor->id);
+        }
+        else if (left & MAILBOX_DEAD) {
+            //martwy i bez poczty - jego miejsce może zająć nowy aktor
+            reclaim_actor(pool, actor);
+
+            //zabieram mutex od całej puli
+            lock_pool(pool);
+
+            //wszyscy martwi - koniec
+            if (pool_finished(pool))
+                finish_pool(pool);
+
+            //oddaję mutex od całej puli
+            if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+        }
+    }
+
+    return NULL;
+}
+
+//dodaje do zbioru procesory węzła NUMA (z /sys); false, gdy węzła nie ma
+bool numa_node_cpus(int node, cpu_set_t* set) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+        return false;
+
+    //format: "0-3,8-11"
+    int from, to;
+    char sep;
+    bool any = false;
+    while (fscanf(f, "%d", &from) == 1) {
+        to = from;
+        if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+            if (fscanf(f, "%d", &to) != 1)
+                break;
+            if (fscanf(f, "%c", &sep) != 1)
+                sep = '\n';
+        }
+        for (int cpu = from; cpu <= to && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+            any = true;
+        }
+        if (sep != ',')
+            break;
+    }
+    fclose(f);
+    return any;
+}
+
+/* ustala, gdzie może działać i-ty wątek; false, gdy konfiguracja jest błędna
+(procesor spoza dostępnych dla procesu albo nieistniejący węzeł NUMA) */
+bool worker_affinity(const actor_system_config_t* config, size_t i, cpu_set_t* set, bool* pinned) {
+    *pinned = false;
+    CPU_ZERO(set);
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return false;
+
+    if (config->cpus != NULL && config->cpus[i] >= 0) {
+        if (config->cpus[i] >= CPU_SETSIZE || !CPU_ISSET(config->cpus[i], &allowed))
+            return false;
+        CPU_SET(config->cpus[i], set);
+        *pinned = true;
+    }
+    else if (config->numa_nodes != NULL && config->numa_nodes[i] >= 0) {
+        if (!numa_node_cpus(config->numa_nodes[i], set))
+            return false;
+        CPU_AND(set, set, &allowed);
+        if (CPU_COUNT(set) == 0)
+            return false;
+        *pinned = true;
+    }
+    return true;
+}
+
+//kończy pierwsze n wątków puli, która nie zdołała się uruchomić
+void stop_workers(pool_t* pool, size_t n) {
+    pthread_mutex_lock(&pool->mutex);
+    atomic_store(&pool->stopping, true);
+    finish_pool(pool);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < n; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+    pthread_cond_destroy(&pool->end);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_mutex_destroy(&pool->timer_lock);
+    pthread_mutex_destroy(&pool->io_lock);
+}
+
+//zwalnia bufory śledzenia
+void free_trace(pool_t* pool) {
+    for (size_t i = 0; i < pool->nworkers && pool->workers != NULL; i++)
+        free(pool->workers[i].trace);
+    free(pool->trace_outside);
+    free(pool->trace_file);
+}
+
+/* przydziela bufory śledzenia wszystkim wątkom i spoza puli; false, gdy
+zabrakło pamięci (wtedy zwalnia je free_trace) */
+bool init_trace(pool_t* pool, const char* file) {
+    pool->trace_file = strdup(file);
+    pool->trace_outside = (trace_ring_t*)calloc(1, sizeof(trace_ring_t));
+    if (pool->trace_file == NULL || pool->trace_outside == NULL)
+        return false;
+    for (size_t i = 0; i < pool->nworkers; i++) {
+        pool->workers[i].trace = (trace_ring_t*)calloc(1, sizeof(trace_ring_t));
+        if (pool->workers[i].trace == NULL)
+            return false;
+    }
+    pool->trace_ns0 = clock_ns();
+    pool->trace_tsc0 = trace_clock();
+    pool->tracing = true;
+    return true;
+}
+
+//zwalnia pulę, w której nie działa żaden wątek
+void free_pool(pool_t* pool, size_t initialized_workers) {
+    for (size_t i = 0; i < initialized_workers; i++) {
+        pthread_cond_destroy(&pool->workers[i].park);
+        pthread_mutex_destroy(&pool->workers[i].park_lock);
+    }
+    free_trace(pool);
+    if (pool->epoll_fd >= 0)
+        close(pool->epoll_fd);
+    if (pool->io_wake_fd >= 0)
+        close(pool->io_wake_fd);
+    free(pool->workers);
+    free(pool->idle);
+    free(pool->segments);
+    for (int c = 0; c < ACTOR_CLASSES; c++)
+        free(pool->queue[c]);
+    free(pool);
+}
+
+//wpisuje system pod wolny numer; false, gdy działa już ACTOR_SYSTEMS systemów
+bool register_system(pool_t* pool) {
+    pthread_mutex_lock(&systems_lock);
+    bool found = false;
+    for (size_t i = 0; i < ACTOR_SYSTEMS && !found; i++) {
+        if (!system_taken[i]) {
+            system_taken[i] = true;
+            pool->index = i;
+            pool->generation = ++system_generations[i];
+            atomic_store_explicit(&systems[i], pool, memory_order_release);
+            running_systems++;
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&systems_lock);
+    return found;
+}
+
+/* wykreśla system z tablicy - nie da się go już przypiąć ani znaleźć po id
+aktora, ale jego numeru nie dostanie jeszcze inny */
+void unlink_system(pool_t* pool) {
+    pthread_mutex_lock(&systems_lock);
+    atomic_store(&systems[pool->index], NULL);
+    if (global_pool == pool)
+        global_pool = NULL;
+    pthread_mutex_unlock(&systems_lock);
+}
+
+/* zwalnia numer systemu (wykreślając go, jeśli jeszcze nie był); po ostatnim
+zwalnia węzły komunikatów (mnode_depot_clear wolno, tylko gdy żaden system
+nie działa) */
+void unregister_system(pool_t* pool) {
+    pthread_mutex_lock(&systems_lock);
+    atomic_store(&systems[pool->index], NULL);
+    system_taken[pool->index] = false;
+    if (global_pool == pool)
+        global_pool = NULL;
+    if (--running_systems == 0)
+        mnode_depot_clear();
+    pthread_mutex_unlock(&systems_lock);
+}
+
+/* tworzy system z wątkami i pierwszym aktorem, który dostaje HELLO; trace_env -
+śledzenie włącza też zmienna CACTI_TRACE (tylko w systemie domyślnym, żeby
+systemy nie pisały do jednego pliku) */
+int start_system(pool_t** system, actor_id_t* actor, role_t* const role, const actor_system_config_t* config, bool trace_env) {
+    actor_system_config_t defaults = { 0 };
+    if (config == NULL)
+        config = &defaults;
+
+    size_t nworkers = config->workers;
+    if (nworkers == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        nworkers = online > 0 ? (size_t)online : 1;
+    }
+
+    //sprawdzam przypięcia przed stworzeniem czegokolwiek
+    for (size_t i = 0; i < nworkers; i++) {
+        cpu_set_t set;
+        bool pinned;
+        if (!worker_affinity(config, i, &set, &pinned))
+            return -5; //błędna konfiguracja
+    }
+
+    pool_t* pool = (pool_t*)calloc(1, sizeof(pool_t));
+    if (pool == NULL)
+        return -1; //nie udało się zaalokować pamięci
+    pool->epoll_fd = -1;
+    pool->io_wake_fd = -1;
+
+    pool->nworkers = nworkers;
+    pool->workers = (worker_t*)calloc(nworkers, sizeof(worker_t));
+    pool->idle = (worker_t**)calloc(nworkers, sizeof(worker_t*));
+    //listy aktorów gotowych do działania (puste)
+    bool queues = true;
+    for (int c = 0; c < ACTOR_CLASSES; c++)
+        queues = (pool->queue[c] = new_queue()) != NULL && queues;
+    //tworzy katalog aktorów (bez segmentów)
+    pool->segments = (_Atomic(actor_segment_t*)*)calloc(ACTOR_SEGMENTS, sizeof(_Atomic(actor_segment_t*)));
+    if (pool->workers == NULL || pool->idle == NULL || !queues || pool->segments == NULL) {
+        free_pool(pool, 0);
+        return -1; //nie udało się zaalokować pamięci
+    }
+    atomic_init(&pool->number, 0); //tyle miejsc zajęto - numer następnego nowego
+    atomic_init(&pool->free_slots, 0);
+    atomic_init(&pool->live_actors, 0);
+    atomic_init(&pool->spawning, 0);
+    atomic_init(&pool->stopping, false);
+    atomic_init(&pool->draining, false);
+
+    atomic_init(&pool->idle_workers, 0);
+    atomic_init(&pool->searching, 0);
+    pool->spin_ns = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? WORKER_SPIN_NS : 0;
+    pool->steal_grace_ns = pool->spin_ns > 0 ? STEAL_GRACE_NS : 0;
+    pool->mailbox_limit = config->mailbox_limit > 0 ? config->mailbox_limit : ACTOR_QUEUE_LIMIT;
+    if (pool->mailbox_limit > MAILBOX_COUNT_MASK)
+        pool->mailbox_limit = MAILBOX_COUNT_MASK;
+    for (int c = 0; c < ACTOR_CLASSES; c++)
+        atomic_init(&pool->queued[c], 0);
+
+    const char* trace_file = config->trace_file != NULL ? config->trace_file : trace_env ? getenv("CACTI_TRACE") : NULL;
+    if (trace_file != NULL && trace_file[0] != '\0' && !init_trace(pool, trace_file)) {
+        free_pool(pool, 0);
+        return -1; //nie udało się zaalokować pamięci
+    }
+
+    for (size_t i = 0; i < nworkers; i++) {
+        worker_t* worker = &pool->workers[i];
+        worker->index = i;
+        worker->pool = pool;
+        worker->ticks = 0;
+        worker->seed = i + 1;
+        worker->lone_q = NULL;
+        for (int c = 0; c < ACTOR_CLASSES; c++)
+            runq_init(&worker->runq[c]);
+
+        worker->wakeup = false;
+        worker->kicked = false;
+        worker->polling = false;
+        if (pthread_mutex_init(&worker->park_lock, 0) != 0) {
+            free_pool(pool, i);
+            return -3; //nie udało się stworzyć mutexa
+        }
+        //zegar monotoniczny, jak clock_ns - pilnujący zegarów śpi do chwili z koła
+        pthread_condattr_t cond_attr;
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        int cond_err = pthread_cond_init(&worker->park, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+        if (cond_err != 0) {
+            pthread_mutex_destroy(&worker->park_lock);
+            free_pool(pool, i);
+            return -3; //nie udało się stworzyć zmiennej warunkowej
+        }
+    }
+
+    if (pthread_mutex_init(&pool->mutex, 0) != 0) {
+        free_pool(pool, nworkers);
+        return -3; //nie udało się stworzyć mutexa
+    }
+    if (pthread_mutex_init(&pool->timer_lock, 0) != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        free_pool(pool, nworkers);
+        return -3; //nie udało się stworzyć mutexa
+    }
+    if (pthread_mutex_init(&pool->io_lock, 0) != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        pthread_mutex_destroy(&pool->timer_lock);
+        free_pool(pool, nworkers);
+        return -3; //nie udało się stworzyć mutexa
+    }
+    wheel_init(&pool->wheel);
+    pool->timer_epoch = clock_ns();
+    atomic_init(&pool->timer_next, UINT64_MAX);
+    atomic_init(&pool->poller, NULL);
+    atomic_init(&pool->io_watched, 0);
+
+    //epoll z pobudką śpiącego w nim wątku
+    pool->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    pool->io_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    struct epoll_event wake = { .events = EPOLLIN, .data.u64 = IO_WAKE };
+    if (pool->epoll_fd < 0 || pool->io_wake_fd < 0 || epoll_ctl(pool->epoll_fd, EPOLL_CTL_ADD, pool->io_wake_fd, &wake) != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        pthread_mutex_destroy(&pool->timer_lock);
+        pthread_mutex_destroy(&pool->io_lock);
+        free_pool(pool, nworkers);
+        return -3; //nie udało się stworzyć epoll
+    }
+    //zegar monotoniczny, jak clock_ns - actor_system_shutdown czeka do chwili
+    pthread_condattr_t end_attr;
+    pthread_condattr_init(&end_attr);
+    pthread_condattr_setclock(&end_attr, CLOCK_MONOTONIC);
+    int end_err = pthread_cond_init(&pool->end, &end_attr);
+    pthread_condattr_destroy(&end_attr);
+    if (end_err != 0) {
+        pthread_mutex_destroy(&pool->mutex);
+        pthread_mutex_destroy(&pool->timer_lock);
+        pthread_mutex_destroy(&pool->io_lock);
+        free_pool(pool, nworkers);
+        return -3; //nie udało się stworzyć zmiennej warunkowej
+    }
+
+    if (!register_system(pool)) {
+        pthread_cond_destroy(&pool->end);
+        pthread_mutex_destroy(&pool->mutex);
+        pthread_mutex_destroy(&pool->timer_lock);
+        pthread_mutex_destroy(&pool->io_lock);
+        free_pool(pool, nworkers);
+        return -1; //działa już ACTOR_SYSTEMS systemów
+    }
+
+    for (size_t i = 0; i < nworkers; i++) {
+        pthread_attr_t attr;
+        if (pthread_attr_init(&attr) != 0 || pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE) != 0) {
+            stop_workers(pool, i);
+            unregister_system(pool);
+            free_pool(pool, nworkers);
+            return -3; //nie udało się stworzyć atrybutów wątku
+        }
+
+        cpu_set_t set;
+        bool pinned;
+        worker_affinity(config, i, &set, &pinned);
+        if (pinned)
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+
+        int err = pthread_create(&pool->workers[i].thread, &attr, work, &pool->workers[i]);
+        pthread_attr_destroy(&attr);
+        if (err != 0) {
+            stop_workers(pool, i);
+            unregister_system(pool);
+            free_pool(pool, nworkers);
+            return -7;
+        }
+    }
+
+    //tworzy pierwszego aktora
+    actor_id_t root = add_actor(pool, role);
+    if (root < 0) {
+        stop_workers(pool, nworkers);
+        unregister_system(pool);
+        free_pool(pool, nworkers);
+        return -7;
+    }
+
+    //zapisuje id pierwszego aktora - przed HELLO, bo aktor może od razu go czytać
+    *system = pool;
+    *actor = root;
+
+    message_t message;
+    message.message_type = MSG_HELLO;
+    message.data = (void*)(-1);
+    message.nbytes = sizeof(message.data);
+    send_message(root, message);
 
     return 0;
 }
 
+int actor_system_create_ex(actor_id_t *actor, role_t *const role, const actor_system_config_t *config) {
+    if (global_pool != NULL) {
+        return -1;
+    }
+
+    pool_t* pool;
+    int err = start_system(&pool, actor, role, config, true);
+    if (err == 0)
+        global_pool = pool;
+    return err;
+}
+
+int actor_system_start(actor_system_t **system, actor_id_t *actor, role_t *const role, const actor_system_config_t *config) {
+    return start_system(system, actor, role, config, false);
+}
+
+int actor_system_create(actor_id_t *actor, role_t *const role) {
+    actor_system_config_t config = { .workers = POOL_SIZE };
+    return actor_system_create_ex(actor, role, &config);
+}
+
+void free_queue(queue_t* q) {
+    while (q->slabs != NULL) {
+        node_slab_t* slab = q->slabs;
+        q->slabs = slab->next;
+        free(slab);
+    }
+    free(q);
+}
+
+//komunikat promptu, którego aktor już nie przetworzy (zatrzymany system) - dla role_t.flush
+static inline void flush_message(actor_t* act, const message_t* message) {
+    if (act->role != NULL && act->role->flush != NULL
+            && message->message_type != MSG_GODIE && message->message_type != MSG_SPAWN)
+        act->role->flush(&act->state, message);
+}
+
+void free_mqueue(actor_t* act) {
+    mnode_t* node;
+    while ((node = mailbox_pop(&act->mailbox)) != NULL) {
+        flush_message(act, &node->val);
+        drop_ask(mnode_ask(node));
+        message_done(node);
+    }
+}
+
+void destroy_actor(actor_t* act) {
+    //prompt czekający w ask_message już się nie skończy - korutyna przepada razem z nim
+    if (act->co != NULL) {
+        drop_ask(&act->asked_by);
+        flush_message(act, &act->co->message);
+        message_done(act->co->node);
+        coroutine_free(act->co);
+        act->co = NULL;
+    }
+    free_mqueue(act);
+    while (act->outgoing != NULL) {
+        pending_send_t* p = act->outgoing;
+        act->outgoing = p->next;
+        flush_message(act, &p->message);
+        free(p);
+    }
+}
+
+//zapisuje zdarzenia jednego bufora (tid - numer wątku w śladzie)
+void write_trace_ring(FILE* f, pool_t* pool, trace_ring_t* ring, size_t tid, double ticks_per_us, bool* comma) {
+    uint64_t end = atomic_load(&ring->next);
+    uint64_t begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+    int pid = (int)getpid();
+
+    fprintf(f, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%zu,\"args\":{\"name\":\"%s %zu\"}}",
+            *comma ? "," : "", pid, tid, tid < pool->nworkers ? "worker" : "outside", tid);
+    *comma = true;
+
+    for (uint64_t i = begin; i < end; i++) {
+        trace_event_t* e = &ring->events[i & (TRACE_RING_SIZE - 1)];
+        double ts = (double)(int64_t)(e->tsc - pool->trace_tsc0) / ticks_per_us;
+        const char* head = ",\n{";
+        switch (e->kind) {
+        case TRACE_BEGIN:
+            fprintf(f, "%s\"ph\":\"B\",\"name\":\"actor %ld\",\"cat\":\"actor\",\"pid\":%d,\"tid\":%zu,\"ts\":%.3f}",
+                    head, (long)e->a, pid, tid, ts);
+            break;
+        case TRACE_END:
+            fprintf(f, "%s\"ph\":\"E\",\"pid\":%d,\"tid\":%zu,\"ts\":%.3f,\"args\":{\"messages\":%u}}",
+                    head, pid, tid, ts, e->n);
+            break;
+        case TRACE_SEND:
+            fprintf(f, "%s\"ph\":\"i\",\"s\":\"t\",\"name\":\"send\",\"cat\":\"message\",\"pid\":%d,\"tid\":%zu,\"ts\":%.3f,"
+                    "\"args\":{\"from\":%ld,\"to\":%ld,\"messages\":%u}}",
+                    head, pid, tid, ts, (long)e->a, (long)e->b, e->n);
+            fprintf(f, "%s\"ph\":\"s\",\"name\":\"message\",\"cat\":\"message\",\"id\":%lu,\"pid\":%d,\"tid\":%zu,\"ts\":%.3f}",
+                    head, (unsigned long)e->flow, pid, tid, ts);
+            break;
+        case TRACE_RECV:
+            fprintf(f, "%s\"ph\":\"f\",\"bp\":\"e\",\"name\":\"message\",\"cat\":\"message\",\"id\":%lu,\"pid\":%d,\"tid\":%zu,\"ts\":%.3f}",
+                    head, (unsigned long)e->flow, pid, tid, ts);
+            break;
+        case TRACE_SPAWN:
+            fprintf(f, "%s\"ph\":\"i\",\"s\":\"t\",\"name\":\"spawn\",\"cat\":\"actor\",\"pid\":%d,\"tid\":%zu,\"ts\":%.3f,"
+                    "\"args\":{\"parent\":%ld,\"child\":%ld}}",
+                    head, pid, tid, ts, (long)e->a, (long)e->b);
+            break;
+        case TRACE_GODIE:
+            fprintf(f, "%s\"ph\":\"i\",\"s\":\"t\",\"name\":\"godie\",\"cat\":\"actor\",\"pid\":%d,\"tid\":%zu,\"ts\":%.3f,"
+                    "\"args\":{\"actor\":%ld}}",
+                    head, pid, tid, ts, (long)e->a);
+            break;
+        }
+    }
+}
+
+/* zapisuje ślad w formacie Chrome (JSON) - wszystkie wątki puli są już
+zakończone; czas w mikrosekundach od startu systemu */
+bool write_trace(pool_t* pool) {
+    FILE* f = fopen(pool->trace_file, "w");
+    if (f == NULL)
+        return false;
+
+    //przelicznik taktów zegara na mikrosekundy, zmierzony na całym czasie działania
+    uint64_t ns = clock_ns() - pool->trace_ns0;
+    uint64_t ticks = trace_clock() - pool->trace_tsc0;
+    double ticks_per_us = ns > 0 && ticks > 0 ? (double)ticks * 1000.0 / (double)ns : 1000.0;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    bool comma = false;
+    for (size_t i = 0; i < pool->nworkers; i++)
+        write_trace_ring(f, pool, pool->workers[i].trace, i, ticks_per_us, &comma);
+    write_trace_ring(f, pool, pool->trace_outside, pool->nworkers, ticks_per_us, &comma);
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
+
+//zwraca coś niezerowego jak coś się wysypie
+int actor_system_destroy(pool_t* pool) {
+    int out = 0, err = 0;
+
+    void* retval;
+    for (size_t i = 0; i < pool->nworkers; i++) {
+        //printf("kończę wątek\n");
+        if ((err = pthread_join(pool->workers[i].thread, &retval)) != 0)
+            out = err;
+        //pthread_attr_destroy(pool->workers[i]);
+    }
+
+    //free(retval); //nie wiem po co to
+
+    /* od teraz wysłania spoza puli zwracają -2; te, które już ją przypięły,
+    mogą jeszcze coś dopisać albo budzić (już niepotrzebnie) jej wątki */
+    unlink_system(pool);
+    while (atomic_load(&system_pins[pool->index].n) > 0)
+        sched_yield();
+
+    //czekający w actor_system_shutdown muszą wyjść, zanim zniknie mutex
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->shutdowns > 0)
+        pthread_cond_wait(&pool->end, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+    pthread_cond_destroy(&pool->end);
+
+    if (pool->tracing && !write_trace(pool))
+        out = -1;
+
+    for (size_t i = 0; i < pool->nworkers; i++) {
+        pthread_cond_destroy(&pool->workers[i].park);
+        pthread_mutex_destroy(&pool->workers[i].park_lock);
+    }
+
+    //gdy wszyscy umarli, skrzynki są puste - nie ma po co ich przeglądać
+    size_t number = atomic_load(&pool->live_actors) > 0 ? atomic_load(&pool->number) : 0;
+    for (size_t i = 0; i < number; i++) {
+        actor_t* actor = actor_at(pool, (actor_id_t)i);
+        //bez komunikatów aktor nie ma też wstrzymanych wysłań ani promptu w toku
+        if (actor != NULL && mailbox_count(&actor->mailbox) > 0)
+            destroy_actor(actor);
+    }
+
+    //zwalnia segmenty areny
+    for (size_t i = 0; i < ACTOR_SEGMENTS; i++) {
+        free(atomic_load(&pool->segments[i]));
+    }
+
+    //czyści kolejki gotowych
+    for (int c = 0; c < ACTOR_CLASSES; c++)
+        free_queue(pool->queue[c]);
+
+    //czyści katalog aktorów
+    free(pool->segments);
+
+    free_trace(pool);
+    free(pool->workers);
+    free(pool->idle);
+
+    if ((err = pthread_mutex_destroy(&pool->mutex)) != 0)
+        out = err;
+
+    //zegary do martwych już aktorów
+    wheel_destroy(&pool->wheel);
+    if ((err = pthread_mutex_destroy(&pool->timer_lock)) != 0)
+        out = err;
+
+    //obserwowane deskryptory zostają otwarte - należą do aktorów
+    free(pool->io_watches);
+    close(pool->epoll_fd);
+    close(pool->io_wake_fd);
+    if ((err = pthread_mutex_destroy(&pool->io_lock)) != 0)
+        out = err;
+
+    unregister_system(pool);
+    free(pool);
+    return out; //0 jeśli udało się zniczczyć wszystkie mutexy
+}
+
+void actor_system_join(actor_id_t actor) {
+    pool_t* pool = pool_of(actor);
+    if (pool == NULL || actor_slot(actor) >= atomic_load(&pool->number))
+        return;
+
+    actor_system_destroy(pool);
+}
+
+void actor_system_wait(actor_system_t *system) {
+    if (system != NULL)
+        actor_system_destroy(system);
+}
+
+actor_system_t *actor_system_of(actor_id_t actor) {
+    return pool_of(actor);
+}
+
+/* kończy bezczynnego aktora (zamykanie SHUTDOWN_DRAIN) w miejscu, bez uszeregowania;
+wynik jak mailbox_kill_idle */
+int kill_idle(pool_t* pool, actor_id_t id) {
+    actor_t* actor = actor_at(pool, id);
+    int killed = mailbox_kill_idle(&actor->mailbox, actor_generation(id));
+    if (killed == 1) {
+        TRACE(pool, TRACE_GODIE, id, -1, 0, 0);
+        reclaim_actor(pool, actor);
+    }
+    return killed;
+}
+
+/* MSG_GODIE do wszystkich żyjących aktorów: bezczynni umierają od razu, reszta
+dostaje go za przyjętymi już komunikatami (poza limitem skrzynki); gotowych
+uszeregowuję po kolei, a wątki budzę na końcu, wszystkie naraz */
+void godie_all(pool_t* pool) {
+    //nowi aktorzy już nie powstaną - czekam tylko na tych, których właśnie tworzą
+    atomic_store(&pool->draining, true);
+    while (atomic_load(&pool->spawning) > 0)
+        sched_yield();
+
+    message_t godie = { .message_type = MSG_GODIE };
+    size_t woken = 0;
+    size_t number = atomic_load(&pool->number);
+    for (size_t slot = 0; slot < number; slot++) {
+        actor_segment_t* segment = segment_of(pool, slot);
+        if (segment == NULL)
+            continue;
+        mailbox_t* mailbox = &segment->actors[slot % ACTOR_CHUNK].mailbox;
+        if (!mailbox_ready(mailbox))
+            continue;
+        actor_id_t id = make_actor_id(pool, mailbox_generation(mailbox), slot);
+        if (kill_idle(pool, id) != 0)
+            continue;
+        //zajęty (albo właśnie skończył - wtedy trzeba go uszeregować)
+        bool ready;
+        if (deliver(id, &godie, 1, false, NULL, false, NULL, &ready) > 0 && ready) {
+            enqueue_ready(pool, id);
+            woken++;
+        }
+    }
+
+    lock_pool(pool);
+    if (pool_finished(pool))
+        finish_pool(pool);
+    if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+    wake_workers(pool, woken);
+}
+
+int actor_system_shutdown_of(actor_system_t *system, int mode, unsigned long timeout_ns) {
+    pool_t* pool = system;
+    if (pool == NULL)
+        return -1;
+    if (mode != SHUTDOWN_DRAIN && mode != SHUTDOWN_NOW)
+        return -5;
+    //wątek puli nie może czekać na koniec - czekałby też na siebie
+    bool inside = my_worker != NULL && my_worker->pool == pool;
+
+    //zapisany zamykający wstrzymuje zwolnienie systemu (actor_system_join w innym wątku)
+    lock_pool(pool);
+    pool->shutdowns++;
+    if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+
+    if (mode == SHUTDOWN_DRAIN)
+        godie_all(pool);
+
+    lock_pool(pool);
+    bool waiting = mode == SHUTDOWN_DRAIN && !inside;
+    if (waiting) {
+        uint64_t now = clock_ns();
+        uint64_t deadline = timeout_ns == SHUTDOWN_NO_TIMEOUT || timeout_ns > UINT64_MAX - now ? UINT64_MAX : now + timeout_ns;
+        struct timespec ts = { .tv_sec = deadline / 1000000000ull, .tv_nsec = deadline % 1000000000ull };
+        while (!pool_finished(pool)) {
+            if (deadline == UINT64_MAX)
+                pthread_cond_wait(&pool->end, &pool->mutex);
+            else if (pthread_cond_timedwait(&pool->end, &pool->mutex, &ts) == ETIMEDOUT)
+                break;
+        }
+    }
+    //nie wszyscy skończyli - zatrzymuję wątki, reszta komunikatów przepada (role_t.flush)
+    int out = 0;
+    if ((waiting || mode == SHUTDOWN_NOW) && atomic_load(&pool->live_actors) > 0) {
+        atomic_store(&pool->stopping, true);
+        finish_pool(pool);
+        out = 1;
+    }
+    pool->shutdowns--;
+    pthread_cond_broadcast(&pool->end);
+    if (pthread_mutex_unlock(&pool->mutex) != 0) {}
+    return out;
+}
+
+int actor_system_shutdown(int mode, unsigned long timeout_ns) {
+    return actor_system_shutdown_of(current_pool(), mode, timeout_ns);
+}
+
+//deliver do przypiętego już systemu odbiorcy
+static int deliver_to(pool_t* pool, actor_id_t actor, const message_t* messages, size_t n, bool copy, shared_buf_t* shared, bool bounded, const ask_token_t* ask, bool* ready) {
+    //taki aktor nie istnieje
+    actor_t* target = actor_at(pool, actor);
+    if (target == NULL)
+        return -2;
+
+    if (n == 0)
+        return 0;
+
+    mailbox_t* mailbox = &target->mailbox;
+
+    uint64_t flow = pool->tracing ? trace_flow(pool) : 0;
+
+    //węzły biorę przed rezerwacją, bo zarezerwowanego miejsca nie da się oddać
+    mnode_t* first = NULL;
+    mnode_t* last = NULL;
+    for (size_t i = n; i-- > 0;) {
+        mnode_t* node = mnode_alloc();
+        if (node == NULL) {
+            while (first != NULL) {
+                node = first;
+                first = atomic_load_explicit(&node->next, memory_order_relaxed);
+                mnode_free(node);
+            }
+            return -4; //nie udało się zaalokować pamięci
+        }
+        node->val = messages[i];
+        *mnode_shared(node) = shared;
+        *mnode_flow(node) = i == 0 ? flow : 0;
+        *mnode_ask(node) = ask != NULL ? *ask : (ask_token_t){ .asker = -1 };
+        if (copy) {
+            memcpy(mnode_payload(node), messages[i].data, messages[i].nbytes);
+            node->val.data = mnode_payload(node);
+        }
+        atomic_store_explicit(&node->next, first, memory_order_relaxed);
+        first = node;
+        if (last == NULL)
+            last = node;
+    }
+
+    //-1: aktor jest martwy (albo to id z jego starego pokolenia), -3: aktor ma pełną kolejkę komunikatów
+    uint64_t reserved = 0;
+    int err = mailbox_reserve_n(mailbox, actor_generation(actor), n, bounded ? target->mailbox_limit : MAILBOX_COUNT_MASK, &reserved);
+    if (err < 0)
+        reserved = 0;
+
+    //oddaję węzły, na które zabrakło miejsca
+    mnode_t* chain_last = first;
+    for (uint64_t i = 1; i < reserved; i++)
+        chain_last = atomic_load_explicit(&chain_last->next, memory_order_relaxed);
+    mnode_t* extra = reserved > 0 ? atomic_load_explicit(&chain_last->next, memory_order_relaxed) : first;
+    while (extra != NULL) {
+        mnode_t* node = extra;
+        extra = atomic_load_explicit(&node->next, memory_order_relaxed);
+        mnode_free(node);
+    }
+
+    if (err < 0)
+        return err;
+
+    /* śledzenie i liczniki przed dopisaniem - potem aktor może przetworzyć komunikat
+    i umrzeć, a jego system (jeśli to nie nasz) się skończyć */
+    TRACE(pool, TRACE_SEND, my_actor_id, actor, flow, (uint32_t)reserved);
+#ifdef CACTI_STATS
+    //rekord długości skrzynki (rezerwacja już się w niej liczy) - CAS tylko wtedy, gdy faktycznie go pobijamy
+    uint64_t length = mailbox_count(mailbox);
+    uint64_t record = atomic_load_explicit(&target->high_water, memory_order_relaxed);
+    while (length > record && !atomic_compare_exchange_weak_explicit(&target->high_water, &record, length,
+                memory_order_relaxed, memory_order_relaxed)) {}
+#endif
+
+    mailbox_push_chain(mailbox, first, chain_last);
+
+    //ten aktor miał pustą listę komunikatów i nikt na nim nie działa
+    *ready = (err == 1);
+    return (int)reserved;
+}
+
+//zakładam, że w momencie wywoływania tego mam mutex???
+/* wkłada do skrzynki aktora ile się zmieści z n komunikatów, jednym CAS-em
+i jedną wymianą końca kolejki; zwraca liczbę przyjętych albo kod błędu jak
+send_message, gdy nie przyjęto żadnego; *ready = true, gdy aktora trzeba
+uszeregować (robi to wywołujący, żeby móc zebrać pobudki); copy - ładunki
+kopiowane są do węzłów (nbytes nie większe niż MESSAGE_INLINE_SIZE); shared -
+bufor, do którego przyjęte komunikaty trzymają referencje (zebrane wcześniej
+przez wywołującego); bounded - z limitem skrzynki odbiorcy (bez niego tylko
+komunikaty, których liczbę ogranicza co innego); ask - pytanie, na które
+odbiorca odpowie przez reply_message (NULL - zwykły komunikat) */
+int deliver(actor_id_t actor, const message_t* messages, size_t n, bool copy, shared_buf_t* shared, bool bounded, const ask_token_t* ask, bool* ready) {
+    *ready = false;
+
+    //system odbiorcy - może być inny niż nadawcy (i właśnie się kończyć)
+    pool_t* pool = pin_actor_system(actor);
+    if (pool == NULL)
+        return -2;
+    int out = deliver_to(pool, actor, messages, n, copy, shared, bounded, ask, ready);
+    unpin_system(pool);
+    return out;
+}
+
+int send_message(actor_id_t actor, message_t message) {
+    bool ready;
+    int err = deliver(actor, &message, 1, false, NULL, true, NULL, &ready);
+    if (err < 0)
+        return err;
+
+    //dodaję aktora do listy gotowych do działania - z wnętrza puli
+    //do lokalnej kolejki wątku, z zewnątrz do kolejki globalnej
+    if (ready)
+        schedule(actor);
+    return 0;
+}
+
+int send_message_wait(actor_id_t actor, message_t message) {
+    //z promptu: pełna skrzynka wstrzymuje aktora, zamiast blokować wątek puli
+    if (my_actor_id >= 0 && actor != my_actor_id) {
+        actor_t* self = actor_at(my_worker->pool, my_actor_id);
+        //wcześniejsze wysłanie już czeka - to idzie za nim, żeby zachować kolejność
+        if (self->outgoing == NULL) {
+            int err = send_message(actor, message);
+            if (err != -3)
+                return err;
+        }
+        pending_send_t* p = malloc(sizeof(pending_send_t));
+        if (p == NULL)
+            return -4; //nie udało się zaalokować pamięci
+        p->to = actor;
+        p->message = message;
+        p->next = NULL;
+        *self->outgoing_tail = p;
+        self->outgoing_tail = &p->next;
+        return 0;
+    }
+
+    int err;
+    while ((err = send_message(actor, message)) == -3) {
+        //przypięty system odbiorcy nie zniknie, póki czekam
+        pool_t* pool = pin_actor_system(actor);
+        actor_t* target = pool != NULL ? actor_at(pool, actor) : NULL;
+        if (target == NULL) {
+            unpin_system(pool);
+            return -2;
+        }
+        //zapisuję się jako czekający i dopiero wtedy sprawdzam (para z wake_senders)
+        if (pthread_mutex_lock(&space_lock) != 0) {}
+        atomic_fetch_add_explicit(&target->blocked_senders, 1, memory_order_seq_cst);
+        if (mailbox_full(&target->mailbox, actor_generation(actor), target->mailbox_limit))
+            pthread_cond_wait(&space_freed, &space_lock);
+        atomic_fetch_sub_explicit(&target->blocked_senders, 1, memory_order_relaxed);
+        if (pthread_mutex_unlock(&space_lock) != 0) {}
+        unpin_system(pool);
+    }
+    return err;
+}
+
+/* uchwyt zegara to uchwyt w kole systemu odbiorcy (47 bitów), nad nim pokolenie
+numeru systemu - uchwyt skończonego systemu nie odwoła zegara następnego pod
+tym samym numerem - i w górnym bajcie sam numer */
+#define TIMER_GEN_SHIFT 47
+#define TIMER_SYSTEM_SHIFT 55
+#define TIMER_HANDLE_MASK (((uint64_t)1 << TIMER_GEN_SHIFT) - 1)
+
+int ask_message(actor_id_t actor, message_t message, message_t *answer) {
+    actor_t* self = my_actor_id >= 0 ? actor_at(my_worker->pool, my_actor_id) : NULL;
+    if (self == NULL || self->co == NULL || actor == my_actor_id)
+        return -5; //nie ma korutyny, na której można czekać
+    coroutine_t* co = self->co;
+
+    //numer pytania nieparzysty - czekam; odpowiedź i oddanie aktora odliczą po jednym
+    ask_token_t ask = { .asker = self->id, .seq = atomic_load_explicit(&self->ask_seq, memory_order_relaxed) + 1 };
+    atomic_store_explicit(&self->ask_seq, ask.seq, memory_order_relaxed);
+    atomic_store_explicit(&self->ask_pending, 2, memory_order_relaxed);
+    bool ready;
+    int err = deliver(actor, &message, 1, false, NULL, true, &ask, &ready);
+    if (err < 0) {
+        atomic_store_explicit(&self->ask_seq, ask.seq + 1, memory_order_relaxed);
+        return err;
+    }
+    if (ready)
+        schedule(actor);
+
+    //wracam do wątku; wznowi mnie (może inny) wątek, gdy przyjdzie odpowiedź albo pytanie przepadnie
+    co_swap(&co->context, co->host);
+    if (co->status == 0)
+        *answer = co->answer;
+    return co->status;
+}
+
+int reply_message(message_t answer) {
+    actor_t* self = my_actor_id >= 0 ? actor_at(my_worker->pool, my_actor_id) : NULL;
+    if (self == NULL)
+        return -5;
+    if (self->asked_by.asker < 0)
+        return -1; //to nie było pytanie
+    int out = complete_ask(self->asked_by, answer, 0);
+    if (out == 0)
+        self->asked_by.asker = -1;
+    return out;
+}
+
+//nastawia zegar z komunikatem za delay nanosekund, okresowy co period taktów (0 - jednorazowy)
+int add_timer(actor_id_t actor, message_t message, uint64_t delay, uint64_t period, timer_id_t* timer) {
+    //zegar trafia do koła systemu odbiorcy
+    pool_t* pool = pin_actor_system(actor);
+    if (pool == NULL || actor_at(pool, actor) == NULL) {
+        unpin_system(pool);
+        return -2;
+    }
+
+    //takt zaokrąglony w górę - komunikat nigdy nie wychodzi przed czasem
+    uint64_t expires = (clock_ns() + delay - pool->timer_epoch + TIMER_TICK_NS - 1) / TIMER_TICK_NS;
+    pthread_mutex_lock(&pool->timer_lock);
+    uint64_t before = atomic_load_explicit(&pool->timer_next, memory_order_relaxed);
+    long handle = wheel_add(&pool->wheel, actor, message, expires, period);
+    if (handle >= 0)
+        update_timer_next(pool);
+    bool earliest = atomic_load_explicit(&pool->timer_next, memory_order_relaxed) < before;
+    pthread_mutex_unlock(&pool->timer_lock);
+
+    if (handle >= 0 && timer != NULL)
+        *timer = handle | (long)((uint64_t)pool->generation << TIMER_GEN_SHIFT | (uint64_t)pool->index << TIMER_SYSTEM_SHIFT);
+    if (handle >= 0 && earliest)
+        kick_poller(pool);
+    unpin_system(pool);
+    return handle >= 0 ? 0 : -4; //-4: nie udało się zaalokować pamięci
+}
+
+int send_message_after(actor_id_t actor, message_t message, unsigned long delay_ns, timer_id_t *timer) {
+    return add_timer(actor, message, delay_ns, 0, timer);
+}
+
+int send_message_every(actor_id_t actor, message_t message, unsigned long period_ns, timer_id_t *timer) {
+    uint64_t period = (period_ns + TIMER_TICK_NS - 1) / TIMER_TICK_NS;
+    return add_timer(actor, message, period_ns, period > 0 ? period : 1, timer);
+}
+
+int timer_cancel(timer_id_t timer) {
+    if (timer < 0)
+        return -1;
+    pool_t* pool = pin_system((uint64_t)timer >> TIMER_SYSTEM_SHIFT);
+    if (pool == NULL)
+        return -1;
+    bool cancelled = false;
+    if ((uint8_t)((uint64_t)timer >> TIMER_GEN_SHIFT) == pool->generation) {
+        pthread_mutex_lock(&pool->timer_lock);
+        cancelled = wheel_cancel(&pool->wheel, (long)((uint64_t)timer & TIMER_HANDLE_MASK));
+        if (cancelled)
+            update_timer_next(pool);
+        pthread_mutex_unlock(&pool->timer_lock);
+    }
+    unpin_system(pool);
+    return cancelled ? 0 : -1;
+}
+
+//io_watch w przypiętym już systemie aktora
+static int watch_fd(pool_t* pool, actor_id_t actor, int fd, unsigned events, message_type_t message_type) {
+    pthread_mutex_lock(&pool->io_lock);
+    if ((size_t)fd >= pool->io_capacity) {
+        size_t capacity = pool->io_capacity == 0 ? 64 : pool->io_capacity;
+        while (capacity <= (size_t)fd)
+            capacity *= 2;
+        io_watch_t* watches = (io_watch_t*)realloc(pool->io_watches, capacity * sizeof(io_watch_t));
+        if (watches == NULL) {
+            pthread_mutex_unlock(&pool->io_lock);
+            return -4; //nie udało się zaalokować pamięci
+        }
+        memset(watches + pool->io_capacity, 0, (capacity - pool->io_capacity) * sizeof(io_watch_t));
+        pool->io_watches = watches;
+        pool->io_capacity = capacity;
+    }
+
+    //used bez rejestracji w epoll - deskryptor zamknięto bez io_unwatch, to nowa obserwacja
+    io_watch_t* watch = &pool->io_watches[fd];
+    struct epoll_event event = { .events = io_epoll_events(events), .data.u64 = ((uint64_t)(watch->gen + 1) << 32) | (uint32_t)fd };
+    if (epoll_ctl(pool->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        int err = errno == EEXIST ? -5 : -4;
+        pthread_mutex_unlock(&pool->io_lock);
+        return err;
+    }
+    if (!watch->used)
+        atomic_fetch_add(&pool->io_watched, 1);
+    watch->gen++;
+    watch->actor = actor;
+    watch->message_type = message_type;
+    watch->used = true;
+    pthread_mutex_unlock(&pool->io_lock);
+
+    //śpiący pilnujący może jeszcze nie czekać w epoll_wait
+    kick_poller(pool);
+    return 0;
+}
+
+int io_watch(actor_id_t actor, int fd, unsigned events, message_type_t message_type) {
+    //deskryptor obsługują wątki systemu aktora
+    pool_t* pool = pin_actor_system(actor);
+    int err = -2;
+    if (pool != NULL && actor_at(pool, actor) != NULL)
+        err = fd < 0 ? -4 : watch_fd(pool, actor, fd, events, message_type);
+    unpin_system(pool);
+    return err;
+}
+
+/* system obserwujący fd, przypięty i z wziętym io_lock (oddaje unlock_io_watch),
+albo NULL: najpierw system wątku wywołującego (zwykle aktor wznawia własną
+obserwację), potem pozostałe */
+pool_t* lock_io_watch(int fd) {
+    if (fd < 0)
+        return NULL;
+    size_t first = my_worker != NULL ? my_worker->pool->index : 0;
+    for (size_t i = 0; i < ACTOR_SYSTEMS; i++) {
+        pool_t* pool = pin_system((first + i) % ACTOR_SYSTEMS);
+        if (pool == NULL)
+            continue;
+        pthread_mutex_lock(&pool->io_lock);
+        if ((size_t)fd < pool->io_capacity && pool->io_watches[fd].used)
+            return pool;
+        pthread_mutex_unlock(&pool->io_lock);
+        unpin_system(pool);
+    }
+    return NULL;
+}
+
+static inline void unlock_io_watch(pool_t* pool) {
+    pthread_mutex_unlock(&pool->io_lock);
+    unpin_system(pool);
+}
+
+int io_rearm(int fd, unsigned events) {
+    pool_t* pool = lock_io_watch(fd);
+    if (pool == NULL)
+        return -1;
+    struct epoll_event event = { .events = io_epoll_events(events),
+        .data.u64 = ((uint64_t)pool->io_watches[fd].gen << 32) | (uint32_t)fd };
+    int err = epoll_ctl(pool->epoll_fd, EPOLL_CTL_MOD, fd, &event) == 0 ? 0 : -4;
+    unlock_io_watch(pool);
+    return err;
+}
+
+int io_unwatch(int fd) {
+    pool_t* pool = lock_io_watch(fd);
+    if (pool == NULL)
+        return -1;
+    epoll_ctl(pool->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    //gotowość odebrana już przez inny wątek przepadnie (inne pokolenie)
+    pool->io_watches[fd].gen++;
+    pool->io_watches[fd].used = false;
+    atomic_fetch_sub(&pool->io_watched, 1);
+    unlock_io_watch(pool);
+    return 0;
+}
+
+int send_messages(actor_id_t actor, const message_t *messages, size_t n) {
+    bool ready;
+    int accepted = deliver(actor, messages, n, false, NULL, true, NULL, &ready);
+    if (ready)
+        schedule(actor);
+    return accepted;
+}
+
+/* uszeregowuje gotowego odbiorcę; system pierwszego gotowego zostaje przypięty,
+a jego wątki budzi potem wake_ready naraz; odbiorców z innych systemów od razu */
+static inline void collect_ready(pool_t** pool, size_t* woken, actor_id_t id) {
+    if (*pool == NULL)
+        *pool = pin_actor_system(id);
+    if (*pool == NULL || (*pool)->index != actor_system_index(id)) {
+        schedule(id);
+        return;
+    }
+    enqueue_ready(*pool, id);
+    (*woken)++;
+}
+
+static inline void wake_ready(pool_t* pool, size_t woken) {
+    if (pool != NULL) {
+        wake_workers(pool, woken);
+        unpin_system(pool);
+    }
+}
+
+int send_multicast(const actor_id_t *actors, size_t n, message_t message) {
+    //aktorów uszeregowuję od razu, a wątki budzę na końcu, wszystkie naraz
+    int accepted = 0;
+    pool_t* pool = NULL;
+    size_t woken = 0;
+    for (size_t i = 0; i < n; i++) {
+        bool ready;
+        if (deliver(actors[i], &message, 1, false, NULL, true, NULL, &ready) == 1)
+            accepted++;
+        if (ready)
+            collect_ready(&pool, &woken, actors[i]);
+    }
+    wake_ready(pool, woken);
+    return accepted;
+}
+
+int send_message_inline(actor_id_t actor, message_type_t message_type, const void *data, size_t nbytes) {
+    if (nbytes > MESSAGE_INLINE_SIZE)
+        return -5; //ładunek nie mieści się w węźle
+
+    message_t message = { .message_type = message_type, .nbytes = nbytes, .data = (void*)data };
+    bool ready;
+    int err = deliver(actor, &message, 1, true, NULL, true, NULL, &ready);
+    if (err < 0)
+        return err;
+    if (ready)
+        schedule(actor);
+    return 0;
+}
+
+int send_shared(actor_id_t actor, message_type_t message_type, shared_buf_t *buf) {
+    message_t message = { .message_type = message_type, .nbytes = buf->nbytes, .data = buf->data };
+    bool ready;
+    //referencję dla komunikatu biorę przed wysłaniem - odbiorca może ją oddać od razu
+    shared_buf_retain(buf);
+    int err = deliver(actor, &message, 1, false, buf, true, NULL, &ready);
+    if (err < 0) {
+        shared_buf_release(buf);
+        return err;
+    }
+    if (ready)
+        schedule(actor);
+    return 0;
+}
+
+int send_multicast_shared(const actor_id_t *actors, size_t n, message_type_t message_type, shared_buf_t *buf) {
+    message_t message = { .message_type = message_type, .nbytes = buf->nbytes, .data = buf->data };
+
+    //referencje dla wszystkich odbiorców naraz, nadmiar oddaję na końcu
+    shared_buf_retain_n(buf, n);
+    int accepted = 0;
+    pool_t* pool = NULL;
+    size_t woken = 0;
+    for (size_t i = 0; i < n; i++) {
+        bool ready;
+        if (deliver(actors[i], &message, 1, false, buf, true, NULL, &ready) == 1)
+            accepted++;
+        if (ready)
+            collect_ready(&pool, &woken, actors[i]);
+    }
+    shared_buf_release_n(buf, n - (size_t)accepted);
+    wake_ready(pool, woken);
+    return accepted;
+}
 
 actor_id_t actor_id_self() {
     return my_actor_id;
 }
 
+#ifdef CACTI_STATS
+void read_counters(counters_t* c, worker_stats_t* out) {
+    out->messages = atomic_load_explicit(&c->messages, memory_order_relaxed);
+    out->activations = atomic_load_explicit(&c->activations, memory_order_relaxed);
+    out->steals = atomic_load_explicit(&c->steals, memory_order_relaxed);
+    out->parks = atomic_load_explicit(&c->parks, memory_order_relaxed);
+    out->idle_ns = atomic_load_explicit(&c->idle_ns, memory_order_relaxed);
+    out->lock_waits = atomic_load_explicit(&c->lock_waits, memory_order_relaxed);
+    out->lock_wait_ns = atomic_load_explicit(&c->lock_wait_ns, memory_order_relaxed);
+    out->global_taken = atomic_load_explicit(&c->global_taken, memory_order_relaxed);
+    out->global_wait_ns = atomic_load_explicit(&c->global_wait_ns, memory_order_relaxed);
+    out->migrations = atomic_load_explicit(&c->migrations, memory_order_relaxed);
+}
+
+//sumuje czekanie według klas ze wszystkich wątków
+void read_class_stats(pool_t* pool, class_stats_t* out) {
+    for (int c = 0; c < ACTOR_CLASSES; c++) {
+        uint64_t hist[WAIT_BUCKETS] = { 0 };
+        for (size_t i = 0; i < pool->nworkers; i++) {
+            counters_t* s = &pool->workers[i].stats;
+            out[c].activations += atomic_load_explicit(&s->class_activations[c], memory_order_relaxed);
+            out[c].wait_ns += atomic_load_explicit(&s->class_wait_ns[c], memory_order_relaxed);
+            uint64_t max = atomic_load_explicit(&s->class_wait_max_ns[c], memory_order_relaxed);
+            if (max > out[c].wait_max_ns)
+                out[c].wait_max_ns = max;
+            for (size_t b = 0; b < WAIT_BUCKETS; b++)
+                hist[b] += atomic_load_explicit(&s->class_wait_hist[c][b], memory_order_relaxed);
+        }
+        //przedział, w którym wypada 99. percentyl - jego górna granica (nie więcej niż maksimum)
+        uint64_t seen = 0;
+        for (size_t b = 0; b < WAIT_BUCKETS && out[c].activations > 0; b++) {
+            seen += hist[b];
+            if (seen * 100 >= out[c].activations * 99) {
+                uint64_t bound = ((uint64_t)2 << b) - 1;
+                out[c].wait_p99_ns = bound < out[c].wait_max_ns ? bound : out[c].wait_max_ns;
+                break;
+            }
+        }
+    }
+}
+#endif
+
+int actor_system_worker_stats(size_t worker, worker_stats_t *stats) {
+#ifdef CACTI_STATS
+    pool_t* pool = current_pool();
+    if (pool == NULL || worker >= pool->nworkers)
+        return -1;
+    read_counters(&pool->workers[worker].stats, stats);
+    return 0;
+#else
+    (void)worker;
+    (void)stats;
+    return -6; //biblioteka bez CACTI_STATS
+#endif
+}
+
+int actor_stats(actor_id_t actor, actor_stats_t *stats) {
+#ifdef CACTI_STATS
+    pool_t* pool = pin_actor_system(actor);
+    actor_t* target = pool != NULL ? actor_at(pool, actor) : NULL;
+    int out = -1;
+    if (target != NULL && mailbox_generation(&target->mailbox) == actor_generation(actor)) {
+        stats->messages = atomic_load_explicit(&target->messages, memory_order_relaxed);
+        stats->mailbox_high_water = atomic_load_explicit(&target->high_water, memory_order_relaxed);
+        out = 0;
+    }
+    unpin_system(pool);
+    return out;
+#else
+    (void)actor;
+    (void)stats;
+    return -6; //biblioteka bez CACTI_STATS
+#endif
+}
+
+int actor_system_stats(actor_system_stats_t *stats) {
+    return actor_system_stats_of(current_pool(), stats);
+}
+
+int actor_system_stats_of(actor_system_t *system, actor_system_stats_t *stats) {
+#ifdef CACTI_STATS
+    pool_t* pool = system;
+    if (pool == NULL)
+        return -1;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->workers = pool->nworkers;
+    for (size_t i = 0; i < pool->nworkers; i++) {
+        worker_stats_t w;
+        read_counters(&pool->workers[i].stats, &w);
+        stats->total.messages += w.messages;
+        stats->total.activations += w.activations;
+        stats->total.steals += w.steals;
+        stats->total.parks += w.parks;
+        stats->total.idle_ns += w.idle_ns;
+        stats->total.lock_waits += w.lock_waits;
+        stats->total.lock_wait_ns += w.lock_wait_ns;
+        stats->total.global_taken += w.global_taken;
+        stats->total.global_wait_ns += w.global_wait_ns;
+        stats->total.migrations += w.migrations;
+    }
+
+    stats->live_actors = atomic_load(&pool->live_actors);
+    for (int c = 0; c < ACTOR_CLASSES; c++)
+        stats->queue_depth += (size_t)atomic_load(&pool->queued[c]);
+    read_class_stats(pool, stats->classes);
+    pthread_mutex_lock(&pool->mutex);
+    stats->queue_high_water = pool->queue_high_water;
+    pthread_mutex_unlock(&pool->mutex);
+
+    //przegląd żyjących aktorów - migawka, nie jest atomowa względem ich pracy
+    stats->busiest_actor = -1;
+    unsigned long busiest = 0;
+    size_t number = atomic_load(&pool->number);
+    for (size_t slot = 0; slot < number; slot++) {
+        actor_t* actor = actor_at(pool, (actor_id_t)slot);
+        if (actor == NULL || (atomic_load(&actor->mailbox.pending) & MAILBOX_DEAD))
+            continue;
+        unsigned long high_water = atomic_load_explicit(&actor->high_water, memory_order_relaxed);
+        unsigned long messages = atomic_load_explicit(&actor->messages, memory_order_relaxed);
+        if (high_water > stats->mailbox_high_water)
+            stats->mailbox_high_water = high_water;
+        if (messages > busiest) {
+            busiest = messages;
+            stats->busiest_actor = make_actor_id(pool, mailbox_generation(&actor->mailbox), slot);
+        }
+    }
+    return 0;
+#else
+    (void)system;
+    (void)stats;
+    return -6; //biblioteka bez CACTI_STATS
+#endif
+}
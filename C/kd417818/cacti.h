@@ -1,6 +1,7 @@
 #ifndef CACTI_H
 #define CACTI_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 typedef long message_type_t;
@@ -21,6 +22,67 @@ typedef long message_type_t;
 #define POOL_SIZE 3
 #endif
 
+//jak długo (w nanosekundach) bezczynny wątek czeka aktywnie na pracę, zanim zaśnie
+#ifndef WORKER_SPIN_NS
+#define WORKER_SPIN_NS 20000
+#endif
+
+/* jedynego gotowego aktora z lokalnej kolejki innego wątku szukający wątek
+zabiera dopiero, gdy ten czeka tam tyle nanosekund - zwykle obudził go aktor
+właściciela kolejki, który zaraz go uruchomi, z komunikatem i stanem wciąż
+w swojej pamięci podręcznej (na jednym procesorze bez czekania) */
+#ifndef STEAL_GRACE_NS
+#define STEAL_GRACE_NS 5000
+#endif
+
+//rozdzielczość zegarów (send_message_after, send_message_every) w nanosekundach
+#ifndef TIMER_TICK_NS
+#define TIMER_TICK_NS 1000000
+#endif
+
+//stos korutyny, na której działa prompt aktora korutynowego (role_t.coroutine), w bajtach
+#ifndef COROUTINE_STACK_SIZE
+#define COROUTINE_STACK_SIZE (64 * 1024)
+#endif
+
+//największy ładunek kopiowany do węzła komunikatu (send_message_inline)
+#ifndef MESSAGE_INLINE_SIZE
+#define MESSAGE_INLINE_SIZE 48
+#endif
+
+//pojemność bufora zdarzeń śledzenia każdego wątku (potęga dwójki)
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 65536
+#endif
+
+//ile komunikatów wątek zabiera ze skrzynki naraz
+#ifndef ACTOR_BATCH_SIZE
+#define ACTOR_BATCH_SIZE 64
+#endif
+
+//ile komunikatów aktor może przetworzyć, zanim wątek odda go innym
+#ifndef ACTOR_FAIRNESS_BUDGET
+#define ACTOR_FAIRNESS_BUDGET 256
+#endif
+
+/* klasy szeregowania aktorów (pole sched_class roli): wątek wybiera najczęściej
+gotowych aktorów klasy wysokiej, ale każda klasa z pracą dostaje swój udział
+wyborów (ACTOR_CLASS_*_SHARE), więc żadnej nie da się zagłodzić */
+#define ACTOR_CLASS_NORMAL 0
+#define ACTOR_CLASS_HIGH 1
+#define ACTOR_CLASS_BACKGROUND 2
+#define ACTOR_CLASSES 3
+
+#ifndef ACTOR_CLASS_HIGH_SHARE
+#define ACTOR_CLASS_HIGH_SHARE 16
+#endif
+#ifndef ACTOR_CLASS_NORMAL_SHARE
+#define ACTOR_CLASS_NORMAL_SHARE 4
+#endif
+#ifndef ACTOR_CLASS_BACKGROUND_SHARE
+#define ACTOR_CLASS_BACKGROUND_SHARE 1
+#endif
+
 typedef struct message
 {
     message_type_t message_type;
@@ -34,16 +96,235 @@ actor_id_t actor_id_self();
 
 typedef void (*const act_t)(void **stateptr, size_t nbytes, void *data);
 
+/* komunikat typu spoza [0, nprompts) przepada, jak wysłany do martwego aktora;
+role z typowanymi komunikatami generuje role.h */
 typedef struct role
 {
     size_t nprompts;
     act_t *prompts;
+    int sched_class; //klasa szeregowania aktorów tej roli (ACTOR_CLASS_*, inne wartości jak NORMAL)
+    size_t mailbox_limit; //limit skrzynki aktorów tej roli (0 - limit systemu)
+    bool coroutine; //prompty na własnym stosie (COROUTINE_STACK_SIZE) - mogą czekać w ask_message
+    /* zatrzymanie systemu (SHUTDOWN_NOW) z żyjącym aktorem tej roli: wywoływane
+    przy sprzątaniu dla każdego komunikatu promptu, którego aktor już nie przetworzy
+    (ze skrzynki, wstrzymanych wysłań send_message_wait i promptu czekającego
+    w ask_message) - np. żeby zwolnić ładunek; NULL - komunikaty przepadają */
+    void (*flush)(void **stateptr, const message_t *message);
 } role_t;
 
 int actor_system_create(actor_id_t *actor, role_t *const role);
 
+//ustawienia systemu aktorów; wyzerowane pola oznaczają wartości domyślne
+typedef struct actor_system_config
+{
+    size_t workers;          //liczba wątków (domyślnie liczba dostępnych procesorów)
+    const int *cpus;         //procesor dla każdego wątku, -1 - bez przypięcia
+    const int *numa_nodes;   //węzeł NUMA dla każdego wątku, -1 - dowolny (gdy nie ma cpus)
+    size_t mailbox_limit;    //limit skrzynki aktora (domyślnie ACTOR_QUEUE_LIMIT)
+    const char *trace_file;  //plik na ślad działania (format Chrome), NULL - zmienna CACTI_TRACE albo bez śladu
+} actor_system_config_t;
+
+/* jak actor_system_create, ale z liczbą wątków i ich przypięciem ustalanymi
+w czasie działania (config może być NULL); -5 oznacza błędną konfigurację */
+int actor_system_create_ex(actor_id_t *actor, role_t *const role, const actor_system_config_t *config);
+
+/* czeka na koniec systemu i sprząta po nim; ze śledzeniem zapisuje ślad
+(JSON do otwarcia w Perfetto albo chrome://tracing) */
 void actor_system_join(actor_id_t actor);
 
+/* w procesie może działać naraz wiele niezależnych systemów (najwyżej 256),
+każdy z własnymi wątkami, przypięciem i limitami - np. osobno dla pracy
+wymagającej krótkich opóźnień i dla masowej; id aktora wskazuje jego system,
+więc send_message i pozostałe wysyłania działają też między systemami, a zegar
+i obserwacja deskryptora należą do systemu odbiorcy; do systemu, który się
+skończył (także w trakcie jego actor_system_join w innym wątku), zwracają -2;
+actor_system_create(_ex) tworzy system domyślny (jeden naraz), do którego
+odnoszą się funkcje bez id wywołane spoza wątków puli */
+typedef struct actor_system actor_system_t;
+
+/* jak actor_system_create_ex, ale tworzy kolejny system (zmienna CACTI_TRACE
+go nie śledzi); uchwyt trafia pod system; -1 także, gdy działa już 256 systemów */
+int actor_system_start(actor_system_t **system, actor_id_t *actor, role_t *const role, const actor_system_config_t *config);
+
+//czeka na koniec systemu (wszyscy jego aktorzy martwi) i sprząta po nim, jak actor_system_join
+void actor_system_wait(actor_system_t *system);
+
+//system aktora; NULL, gdy takiego systemu nie ma
+actor_system_t *actor_system_of(actor_id_t actor);
+
+/* sposoby zamykania systemu: SHUTDOWN_DRAIN - wszyscy żyjący aktorzy dostają
+MSG_GODIE (bezczynni umierają od razu, pozostali po komunikatach przyjętych
+wcześniej), a MSG_SPAWN nie tworzy już nowych; SHUTDOWN_NOW - wątki kończą się
+po bieżących komunikatach, a te, których nikt już nie przetworzy, dostaje przy
+sprzątaniu role_t.flush */
+#define SHUTDOWN_DRAIN 0
+#define SHUTDOWN_NOW 1
+//SHUTDOWN_DRAIN bez limitu czasu
+#define SHUTDOWN_NO_TIMEOUT (~0UL)
+
+/* zamyka system domyślny (z wątku puli - jego system): SHUTDOWN_DRAIN czeka
+najwyżej timeout_ns na śmierć wszystkich aktorów, a potem zatrzymuje system jak
+SHUTDOWN_NOW; sprząta po nim actor_system_join (albo actor_system_wait) - także
+wywołany wcześniej w innym wątku, który wtedy przestaje czekać; z wątku puli
+zamykanego systemu tylko zaczyna zamykanie, bez czekania (i zwraca 0);
+0 - wszyscy aktorzy skończyli, 1 - system zatrzymany z żyjącymi aktorami,
+-1 - system nie działa, -5 - nieznany sposób */
+int actor_system_shutdown(int mode, unsigned long timeout_ns);
+
+//jak actor_system_shutdown, dla podanego systemu
+int actor_system_shutdown_of(actor_system_t *system, int mode, unsigned long timeout_ns);
+
 int send_message(actor_id_t actor, message_t message);
 
+/* jak send_message, ale pełna skrzynka odbiorcy nie kończy się błędem -3, tylko
+czekaniem, aż odbiorca zrobi miejsce: wątek spoza puli jest blokowany, a aktor
+(wywołanie z promptu) wstrzymywany - prompt wraca od razu, ale aktor nie dostaje
+kolejnych komunikatów, dopóki wszystkie jego czekające wysłania nie zostaną po
+kolei dostarczone; wątek puli w tym czasie obsługuje innych aktorów; do siebie
+działa jak send_message (czekanie na siebie nigdy by się nie skończyło); wstrzymany
+komunikat do aktora, który w międzyczasie umarł, przepada jak przy send_message */
+int send_message_wait(actor_id_t actor, message_t message);
+
+/* z promptu aktora korutynowego: wysyła komunikat i wstrzymuje prompt, aż
+odbiorca odpowie przez reply_message - odpowiedź trafia pod answer; wątek puli
+w tym czasie obsługuje innych aktorów, a pytający nie dostaje kolejnych
+komunikatów, dopóki jego prompt się nie skończy; -2 (po czekaniu), gdy
+odpowiedź już nie przyjdzie: prompt odbiorcy wrócił bez reply_message, typ
+pytania jest spoza jego roli albo odbiorca umarł lub jego system zatrzymano,
+zanim pytanie przetworzył; pytanie w koło wstrzymuje pytających na zawsze;
+-5 spoza promptu aktora korutynowego i do siebie, inne błędy jak send_message
+(wtedy bez czekania) */
+int ask_message(actor_id_t actor, message_t message, message_t *answer);
+
+/* odpowiada na komunikat obsługiwany w tej chwili przez prompt, jeśli przyszedł
+przez ask_message (odpowiada się raz); -1 - to nie było pytanie albo już na nie
+odpowiedziano, -2 - pytający nie żyje, -5 - spoza promptu */
+int reply_message(message_t answer);
+
+//uchwyt zegara (do timer_cancel)
+typedef long timer_id_t;
+
+/* wysyła komunikat za delay_ns nanosekund - nie wcześniej, z dokładnością do
+TIMER_TICK_NS; zegary obsługują wątki puli (bez osobnego wątku); uchwyt trafia
+pod timer, jeśli nie jest NULL; odbiorca, który w międzyczasie umarł albo ma
+pełną skrzynkę, traci komunikat jak przy send_message; -2 - nie ma systemu
+albo aktora, -4 - brak pamięci */
+int send_message_after(actor_id_t actor, message_t message, unsigned long delay_ns, timer_id_t *timer);
+
+/* wysyła komunikat co period_ns (najmniej co takt, pierwszy raz za period_ns),
+aż zegar zostanie odwołany albo odbiorca umrze; spóźnione odpalenia nie są
+nadrabiane; błędy jak send_message_after */
+int send_message_every(actor_id_t actor, message_t message, unsigned long period_ns, timer_id_t *timer);
+
+//odwołuje zegar; -1, gdy już go nie ma (odpalił jednorazowy, był odwołany albo nie działa system)
+int timer_cancel(timer_id_t timer);
+
+//zdarzenia deskryptorów (io_watch); w komunikacie o gotowości nbytes to te, które zaszły
+#define IO_READ 1
+#define IO_WRITE 2
+#define IO_HUP 4   //druga strona się zamknęła
+#define IO_ERROR 8
+
+/* obserwuje nieblokujący deskryptor fd w imieniu aktora: gdy fd będzie gotowy
+do zdarzeń events (IO_READ, IO_WRITE), aktor dostanie komunikat message_type
+z nbytes - zdarzeniami, które zaszły, i data - deskryptorem; potem obserwacja
+czeka na io_rearm (zwykle po przeczytaniu lub zapisaniu, ile się dało), więc
+na deskryptor przypada najwyżej jeden taki komunikat w skrzynce - nie liczą się
+one do jej limitu; epoll odpytują wątki puli, bez osobnego wątku; -2 - nie ma
+systemu albo aktora, -4 - błąd epoll (errno) albo brak pamięci, -5 - fd jest
+już obserwowany */
+int io_watch(actor_id_t actor, int fd, unsigned events, message_type_t message_type);
+
+//wznawia obserwację (także z innymi zdarzeniami); -1, gdy fd nie jest obserwowany
+int io_rearm(int fd, unsigned events);
+
+/* kończy obserwację (przed zamknięciem fd); nie zamyka fd; może jeszcze przyjść
+komunikat o gotowości rozsyłanej właśnie w tej chwili; -1, gdy fd nie był obserwowany */
+int io_unwatch(int fd);
+
+/* wysyła n komunikatów jedną synchronizacją, budząc najwyżej jeden wątek;
+zwraca liczbę przyjętych (mniej niż n, gdy skrzynka zapełniła się w trakcie)
+albo kod błędu jak send_message, gdy nie przyjęto żadnego */
+int send_messages(actor_id_t actor, const message_t *messages, size_t n);
+
+//wysyła ten sam komunikat do n aktorów; zwraca, ilu go przyjęło
+int send_multicast(const actor_id_t *actors, size_t n, message_t message);
+
+/* wysyła komunikat z kopią nbytes bajtów spod data (najwyżej MESSAGE_INLINE_SIZE,
+inaczej -5) trzymaną w samym węźle skrzynki - bez malloca po stronie nadawcy;
+prompt dostaje wskaźnik do tej kopii, ważny tylko do końca jego wykonania */
+int send_message_inline(actor_id_t actor, message_type_t message_type, const void *data, size_t nbytes);
+
+/* niezmienny bufor z licznikiem referencji, wysyłany bez kopiowania; twórca
+wypełnia go przed pierwszym wysłaniem i ma jedną referencję, którą na końcu
+oddaje przez shared_buf_release; każdy przyjęty komunikat trzyma własną
+referencję, oddawaną po wykonaniu promptu (prompt dostaje data i nbytes bufora) */
+typedef struct shared_buf shared_buf_t;
+
+//NULL, gdy nie udało się zaalokować pamięci
+shared_buf_t *shared_buf_create(size_t nbytes);
+void *shared_buf_data(shared_buf_t *buf);
+size_t shared_buf_size(const shared_buf_t *buf);
+//bufor, do którego należą dane z promptu - żeby zatrzymać go dłużej (shared_buf_retain)
+shared_buf_t *shared_buf_of(void *data);
+void shared_buf_retain(shared_buf_t *buf);
+void shared_buf_release(shared_buf_t *buf);
+
+int send_shared(actor_id_t actor, message_type_t message_type, shared_buf_t *buf);
+
+//jak send_multicast, ale z jednym buforem dla wszystkich odbiorców
+int send_multicast_shared(const actor_id_t *actors, size_t n, message_type_t message_type, shared_buf_t *buf);
+
+/* liczniki działania systemu - zbierane tylko w bibliotece skompilowanej
+z CACTI_STATS; bez tego funkcje poniżej zwracają -6 */
+typedef struct worker_stats
+{
+    unsigned long messages;      //przetworzone komunikaty
+    unsigned long activations;   //uruchomienia aktorów
+    unsigned long steals;        //udane kradzieże z kolejek innych wątków
+    unsigned long parks;         //zaśnięcia z braku pracy
+    unsigned long idle_ns;       //czas szukania pracy, gdy nie było jej od razu (czekanie i sen)
+    unsigned long lock_waits;    //ile razy mutex puli był zajęty
+    unsigned long lock_wait_ns;  //czas czekania na mutex puli
+    unsigned long global_taken;  //aktorzy wzięci z kolejki globalnej
+    unsigned long global_wait_ns; //ich łączny czas oczekiwania w tej kolejce
+    unsigned long migrations;    //aktywacje na innym wątku niż poprzednia aktywacja tego aktora
+} worker_stats_t;
+
+//czas od gotowości aktora (komunikat w pustej skrzynce) do jego uruchomienia
+typedef struct class_stats
+{
+    unsigned long activations;  //uruchomienia aktorów tej klasy
+    unsigned long wait_ns;      //ich łączne czekanie w kolejkach gotowych
+    unsigned long wait_max_ns;  //najdłuższe
+    unsigned long wait_p99_ns;  //99. percentyl (górna granica przedziału potęgi dwójki)
+} class_stats_t;
+
+typedef struct actor_system_stats
+{
+    size_t workers;
+    worker_stats_t total;          //suma po wszystkich wątkach
+    size_t live_actors;
+    size_t queue_depth;            //aktorzy w kolejce globalnej teraz
+    size_t queue_high_water;       //i najwięcej naraz
+    unsigned long mailbox_high_water; //najdłuższa skrzynka spośród żyjących aktorów
+    actor_id_t busiest_actor;      //aktor, który przetworzył najwięcej komunikatów (-1 - brak)
+    class_stats_t classes[ACTOR_CLASSES]; //według klasy szeregowania
+} actor_system_stats_t;
+
+typedef struct actor_stats
+{
+    unsigned long messages;           //przetworzone komunikaty
+    unsigned long mailbox_high_water; //najwięcej komunikatów w skrzynce naraz
+} actor_stats_t;
+
+//migawka liczników (systemu wywołującego wątku puli, spoza puli - domyślnego); -1, gdy system nie działa
+int actor_system_stats(actor_system_stats_t *stats);
+//migawka liczników podanego systemu
+int actor_system_stats_of(actor_system_t *system, actor_system_stats_t *stats);
+//liczniki jednego wątku (systemu jak wyżej); -1, gdy system nie działa albo nie ma takiego wątku
+int actor_system_worker_stats(size_t worker, worker_stats_t *stats);
+//liczniki aktora; -1, gdy aktor nie żyje albo go nie ma
+int actor_stats(actor_id_t actor, actor_stats_t *stats);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+/* przełączanie kontekstu dla korutyn (prompty aktorów korutynowych): na x86-64
+kilka instrukcji - tylko rejestry zachowywane przez wywołanego, bez maski
+sygnałów i wywołań systemowych; gdzie indziej (albo z CACTI_UCONTEXT) ucontext;
+stosy z mmap, ze stroną ochronną na dole - przepełnienie kończy się błędem
+strony, a nie nadpisaniem cudzej pamięci */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && !defined(CACTI_UCONTEXT)
+#define CO_ASM
+#else
+#include <ucontext.h>
+#endif
+
+//ThreadSanitizer trzyma własny stos wywołań - trzeba mu mówić o przełączeniach
+#if defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define CO_TSAN
+#endif
+#elif defined(__SANITIZE_THREAD__)
+#define CO_TSAN
+#endif
+#ifdef CO_TSAN
+#include <sanitizer/tsan_interface.h>
+#endif
+
+typedef struct co_context {
+#ifdef CO_ASM
+    void* sp; //wierzchołek stosu z zachowanymi rejestrami
+#else
+    ucontext_t uc;
+    void (*entry)(void*);
+    void* arg;
+#endif
+#ifdef CO_TSAN
+    void* fiber;
+#endif
+} co_context_t;
+
+#ifdef CO_ASM
+/* co_swap zapisuje rejestry na stosie i jego wierzchołek pod *from, po czym
+wraca na stos to; co_start to pierwszy powrót nowej korutyny: entry(arg) z
+r13 i r12, przygotowanych przez co_make (symbole lokalne w pliku) */
+void cacti_co_swap(void** from, void* to);
+void cacti_co_start(void);
+__asm__(
+    ".text\n"
+    ".type cacti_co_swap, @function\n"
+    "cacti_co_swap:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size cacti_co_swap, .-cacti_co_swap\n"
+    ".type cacti_co_start, @function\n"
+    "cacti_co_start:\n"
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    ".size cacti_co_start, .-cacti_co_start\n");
+
+/* nowa korutyna zaczyna od entry(arg) na stosie [stack, stack + size); entry
+nigdy nie wraca */
+static inline void co_make_context(co_context_t* c, void* stack, size_t size, void (*entry)(void*), void* arg) {
+    //po zdjęciu rejestrów i powrocie do co_start wierzchołek jest wyrównany do 16
+    uintptr_t top = ((uintptr_t)stack + size) & ~(uintptr_t)15;
+    void** sp = (void**)(top - 9 * sizeof(void*));
+    sp[0] = NULL;           //r15
+    sp[1] = NULL;           //r14
+    sp[2] = (void*)entry;   //r13
+    sp[3] = arg;            //r12
+    sp[4] = NULL;           //rbx
+    sp[5] = NULL;           //rbp
+    sp[6] = (void*)cacti_co_start;
+    sp[7] = NULL;
+    sp[8] = NULL;
+    c->sp = sp;
+}
+
+static inline void co_switch(co_context_t* from, co_context_t* to) {
+    cacti_co_swap(&from->sp, to->sp);
+}
+#else
+//makecontext przekazuje tylko argumenty int - wskaźnik na kontekst w dwóch połówkach
+static void co_trampoline(unsigned hi, unsigned lo) {
+    co_context_t* c = (co_context_t*)(((uintptr_t)hi << 32) | lo);
+    c->entry(c->arg);
+}
+
+static inline void co_make_context(co_context_t* c, void* stack, size_t size, void (*entry)(void*), void* arg) {
+    getcontext(&c->uc);
+    c->uc.uc_stack.ss_sp = stack;
+    c->uc.uc_stack.ss_size = size;
+    c->uc.uc_link = NULL;
+    c->entry = entry;
+    c->arg = arg;
+    uintptr_t p = (uintptr_t)c;
+    makecontext(&c->uc, (void (*)(void))co_trampoline, 2, (unsigned)(p >> 32), (unsigned)p);
+}
+
+static inline void co_switch(co_context_t* from, co_context_t* to) {
+    swapcontext(&from->uc, &to->uc);
+}
+#endif
+
+//kontekst korutyny; zwalnia go co_destroy (stos osobno)
+static inline void co_make(co_context_t* c, void* stack, size_t size, void (*entry)(void*), void* arg) {
+    co_make_context(c, stack, size, entry, arg);
+#ifdef CO_TSAN
+    c->fiber = __tsan_create_fiber(0);
+#endif
+}
+
+static inline void co_destroy(co_context_t* c) {
+#ifdef CO_TSAN
+    __tsan_destroy_fiber(c->fiber);
+#else
+    (void)c;
+#endif
+}
+
+//zapisuje bieżący kontekst (korutyny albo wątku) w from i wznawia to
+static inline void co_swap(co_context_t* from, co_context_t* to) {
+#ifdef CO_TSAN
+    from->fiber = __tsan_get_current_fiber();
+    __tsan_switch_to_fiber(to->fiber, 0);
+#endif
+    co_switch(from, to);
+}
+
+//stos size bajtów (nad stroną ochronną); NULL, gdy zabrakło pamięci
+static inline void* co_stack_alloc(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char* base = (char*)mmap(NULL, size + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+    mprotect(base, page, PROT_NONE);
+    return base + page;
+}
+
+static inline void co_stack_free(void* stack, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    munmap((char*)stack - page, size + page);
+}
+
+#endif
@@ -1,5 +1,155 @@
 #include "cacti.h"
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <semaphore.h>
+#include <time.h>
 
-int main(){
+/* sumy wierszy macierzy k×n: na wejściu k, n i k*n par "wartość czas" (wierszami,
+czas liczenia komórki w milisekundach, najwyżej MAX_COST); każda kolumna ma
+swojego aktora, a wiersze przechodzą potokiem od kolumny 0 do n-1 - kolumny
+liczą naraz różne wiersze; ostatnia wypisuje sumę, więc wyniki wychodzą po
+kolei, a w drodze jest naraz najwyżej WINDOW wierszy (macierz nie jest
+trzymana w pamięci w całości)
+użycie: macierz [wątki] (domyślnie POOL_SIZE) */
+
+#define MSG_ROW 1
+#define MSG_END 2
+
+//okno mieści się w skrzynce kolumny razem z MSG_END - wysłanie nie zawiedzie
+#define WINDOW (ACTOR_QUEUE_LIMIT <= 256 ? ACTOR_QUEUE_LIMIT - 1 : 256)
+
+//najdłuższy czas liczenia komórki (doba, w milisekundach) - dłuższy to błąd wejścia
+#define MAX_COST 86400000
+
+typedef struct cell {
+	int value;
+	int cost;
+} cell_t;
+
+typedef struct row {
+	int64_t sum;
+	cell_t cells[];
+} row_t;
+
+int64_t k, n;
+
+//id aktorów kolumn - zapisuje je każdy aktor w swoim hello
+actor_id_t* columns;
+_Atomic int64_t spawned;
+
+//wszystkie kolumny gotowe / ile wierszy można jeszcze wpuścić do potoku
+sem_t ready;
+sem_t window;
+
+role_t role;
+
+message_t msgSpawn;
+message_t msgGoDie = {
+	.message_type = MSG_GODIE
+};
+
+//kolumny tworzą się łańcuchem, stan aktora to numer jego kolumny
+void hello(void** stateptr, size_t size, void* data) {
+	(void)(size);
+	(void)(data);
+	int64_t j = atomic_fetch_add(&spawned, 1);
+	columns[j] = actor_id_self();
+	*stateptr = (void*)j;
+	if (j + 1 < n)
+		send_message(actor_id_self(), msgSpawn);
+	else
+		sem_post(&ready);
+}
+
+void row(void** stateptr, size_t size, void* data) {
+	(void)(size);
+	int64_t j = (int64_t)(*stateptr);
+	row_t* r = data;
+	int64_t ns = (int64_t)r->cells[j].cost * 1000000;
+	struct timespec ts = { .tv_sec = ns / 1000000000, .tv_nsec = ns % 1000000000 };
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+	r->sum += r->cells[j].value;
+
+	if (j + 1 < n) {
+		message_t msg = {
+			.message_type = MSG_ROW,
+			.nbytes = sizeof(row_t*),
+			.data = r
+		};
+		send_message(columns[j + 1], msg);
+		return;
+	}
+	printf("%ld\n", r->sum);
+	free(r);
+	sem_post(&window);
+}
+
+//wiersze się skończyły - kolumna przekazuje to dalej i umiera
+void end(void** stateptr, size_t size, void* data) {
+	(void)(size);
+	(void)(data);
+	int64_t j = (int64_t)(*stateptr);
+	if (j + 1 < n) {
+		message_t msg = {
+			.message_type = MSG_END
+		};
+		send_message(columns[j + 1], msg);
+	}
+	send_message(actor_id_self(), msgGoDie);
+}
+
+int main(int argc, char** argv) {
+	if (scanf("%ld %ld", &k, &n) != 2 || k < 0 || n <= 0 || n >= CAST_LIMIT)
+		exit(1);
+
+	columns = malloc(sizeof(actor_id_t) * n);
+	if (columns == NULL)
+		exit(1);
+	sem_init(&ready, 0, 0);
+	sem_init(&window, 0, WINDOW);
+
+	act_t prompts[] = { hello, row, end };
+	role.nprompts = 3;
+	role.prompts = prompts;
+	msgSpawn.message_type = MSG_SPAWN;
+	msgSpawn.data = &role;
+
+	actor_system_config_t config = {
+		.workers = argc > 1 ? (size_t)atol(argv[1]) : POOL_SIZE
+	};
+	actor_id_t first;
+	if (actor_system_create_ex(&first, &role, &config) != 0)
+		exit(1);
+	sem_wait(&ready);
+
+	//wiersz czytam dopiero, gdy zwolni się dla niego miejsce w potoku
+	for (int64_t i = 0; i < k; i++) {
+		sem_wait(&window);
+		row_t* r = malloc(sizeof(row_t) + sizeof(cell_t) * n);
+		if (r == NULL)
+			exit(1);
+		r->sum = 0;
+		for (int64_t j = 0; j < n; j++) {
+			if (scanf("%d %d", &r->cells[j].value, &r->cells[j].cost) != 2 || r->cells[j].cost < 0 || r->cells[j].cost > MAX_COST)
+				exit(1);
+		}
+		message_t msg = {
+			.message_type = MSG_ROW,
+			.nbytes = sizeof(row_t*),
+			.data = r
+		};
+		send_message(first, msg);
+	}
+	message_t msg = {
+		.message_type = MSG_END
+	};
+	send_message(first, msg);
+
+	actor_system_join(first);
+	sem_destroy(&ready);
+	sem_destroy(&window);
+	free(columns);
 	return 0;
 }
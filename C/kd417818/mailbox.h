@@ -0,0 +1,234 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+/* skrzynka komunikatów aktora - kolejka MPSC Wjukowa (intruzywna, bez mutexa)
+z licznikiem komunikatów pilnującym limitu i flagi śmierci aktora */
+
+#include "cacti.h"
+#include <sched.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+//węzeł z wiadomością
+typedef struct mnode {
+    message_t val;
+    _Atomic(struct mnode*) next;
+} mnode_t;
+
+//kto czeka na odpowiedź na komunikat (ask_message): aktor i numer jego pytania
+typedef struct ask_token {
+    actor_id_t asker; //-1 - nikt
+    uint32_t seq;
+} ask_token_t;
+
+/* węzeł przydzielany przez mnode_alloc ma za sobą wspólny bufor, do którego
+komunikat trzyma referencję, i miejsce na ładunek komunikatu (stub skrzynki
+to sam węzeł, bez nich) */
+typedef struct mnode_slot {
+    mnode_t node;
+    struct shared_buf* shared;
+    //wysłanie, które przyniosło komunikat (śledzenie; 0 - brak)
+    uint64_t flow;
+    ask_token_t ask;
+    _Alignas(max_align_t) unsigned char payload[MESSAGE_INLINE_SIZE];
+} mnode_slot_t;
+
+static inline void* mnode_payload(mnode_t* node) {
+    return ((mnode_slot_t*)node)->payload;
+}
+
+static inline struct shared_buf** mnode_shared(mnode_t* node) {
+    return &((mnode_slot_t*)node)->shared;
+}
+
+static inline uint64_t* mnode_flow(mnode_t* node) {
+    return &((mnode_slot_t*)node)->flow;
+}
+
+static inline ask_token_t* mnode_ask(mnode_t* node) {
+    return &((mnode_slot_t*)node)->ask;
+}
+
+//przydział i zwolnienie węzła (pamięć podręczna wątku, bez malloca w typowym przypadku)
+mnode_t* mnode_alloc();
+void mnode_free(mnode_t* node);
+//oddaje węzły z pamięci podręcznej wątku do wspólnego magazynu
+void mnode_cache_flush();
+
+//licznik komunikatów zajmuje dolne bity słowa pending
+#define MAILBOX_COUNT_MASK (((uint64_t)1 << 31) - 1)
+//aktor przetworzył MSG_GODIE - nie przyjmuje nowych komunikatów
+#define MAILBOX_DEAD ((uint64_t)1 << 31)
+/* górne bity to pokolenie miejsca w tablicy aktorów - komunikat do aktora
+z innego pokolenia (dawno martwego) jest odrzucany tym samym CAS-em */
+#define MAILBOX_GEN_SHIFT 32
+#define MAILBOX_GEN_MASK (((uint64_t)1 << 31) - 1)
+
+#define CACHE_LINE 64
+
+/* pola zmieniane przez nadawców zajmują pierwszą linię pamięci podręcznej, pola
+wątku obsługującego aktora drugą (razem z tym, co właściciel skrzynki dopisze za nią) */
+typedef struct mailbox {
+    /* liczba komunikatów przyjętych, a jeszcze nieprzetworzonych, i flaga śmierci;
+    przejście licznika z 0 na 1 oznacza, że aktora trzeba dodać do gotowych */
+    _Atomic uint64_t pending;
+
+    //koniec kolejki - tu dopisują nadawcy
+    _Atomic(mnode_t*) tail;
+
+    char pad[CACHE_LINE - sizeof(uint64_t) - sizeof(mnode_t*)];
+
+    //początek kolejki - używa go tylko wątek obsługujący aktora
+    mnode_t* head;
+    mnode_t stub;
+} mailbox_t;
+
+/* koniec kolejki zapisywany jest na końcu ze zwolnieniem - kto zobaczy niepusty
+tail, widzi też całą zainicjowaną skrzynkę (i to, co zapisano przed mailbox_init);
+skrzynkę po martwym aktorze wolno zainicjować ponownie, nikt już do niej nie pisze */
+static inline void mailbox_init(mailbox_t* mb, uint64_t gen) {
+    atomic_store_explicit(&mb->pending, gen << MAILBOX_GEN_SHIFT, memory_order_relaxed);
+    atomic_store_explicit(&mb->stub.next, NULL, memory_order_relaxed);
+    mb->head = &mb->stub;
+    atomic_store_explicit(&mb->tail, &mb->stub, memory_order_release);
+}
+
+//czy skrzynka została już zainicjowana (pamięć wyzerowana przed mailbox_init)
+static inline bool mailbox_ready(mailbox_t* mb) {
+    return atomic_load_explicit(&mb->tail, memory_order_acquire) != NULL;
+}
+
+/* rezerwuje do n miejsc na komunikaty dla aktora z pokolenia gen, ile się zmieści;
+liczbę zarezerwowanych zapisuje w *reserved; zwraca 1, gdy skrzynka była pusta
+(trzeba uszeregować aktora), 0 gdy nie, -1 gdy aktor nie żyje, -3 gdy skrzynka pełna */
+static inline int mailbox_reserve_n(mailbox_t* mb, uint64_t gen, uint64_t n, uint64_t limit, uint64_t* reserved) {
+    uint64_t old = atomic_load_explicit(&mb->pending, memory_order_relaxed);
+    uint64_t take;
+    do {
+        if ((old & MAILBOX_DEAD) || (old >> MAILBOX_GEN_SHIFT) != gen)
+            return -1;
+        uint64_t count = old & MAILBOX_COUNT_MASK;
+        if (count >= limit)
+            return -3;
+        take = limit - count < n ? limit - count : n;
+    } while (!atomic_compare_exchange_weak_explicit(&mb->pending, &old, old + take,
+                memory_order_acq_rel, memory_order_relaxed));
+    *reserved = take;
+    return (old & MAILBOX_COUNT_MASK) == 0;
+}
+
+static inline int mailbox_reserve(mailbox_t* mb, uint64_t gen, uint64_t limit) {
+    uint64_t reserved;
+    return mailbox_reserve_n(mb, gen, 1, limit, &reserved);
+}
+
+//dopisuje węzeł na koniec - może wywołać dowolny wątek
+static inline void mailbox_push(mailbox_t* mb, mnode_t* node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    mnode_t* prev = atomic_exchange_explicit(&mb->tail, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+//dopisuje naraz łańcuch węzłów first..last (połączonych przez next)
+static inline void mailbox_push_chain(mailbox_t* mb, mnode_t* first, mnode_t* last) {
+    atomic_store_explicit(&last->next, NULL, memory_order_relaxed);
+    mnode_t* prev = atomic_exchange_explicit(&mb->tail, last, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, first, memory_order_release);
+}
+
+/* zabiera węzeł z początku - wywołuje tylko wątek obsługujący aktora;
+NULL, gdy kolejka jest pusta albo nadawca jeszcze nie podpiął węzła */
+static inline mnode_t* mailbox_pop(mailbox_t* mb) {
+    mnode_t* head = mb->head;
+    mnode_t* next = atomic_load_explicit(&head->next, memory_order_acquire);
+
+    if (head == &mb->stub) {
+        if (next == NULL)
+            return NULL;
+        mb->head = next;
+        head = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+
+    if (next != NULL) {
+        mb->head = next;
+        return head;
+    }
+
+    if (head != atomic_load_explicit(&mb->tail, memory_order_acquire))
+        return NULL;
+
+    //został jeden węzeł - wstawiam za nim stub, żeby móc go zabrać
+    mailbox_push(mb, &mb->stub);
+    next = atomic_load_explicit(&head->next, memory_order_acquire);
+    if (next != NULL) {
+        mb->head = next;
+        return head;
+    }
+    return NULL;
+}
+
+/* zabiera węzeł, o którym wiadomo z licznika, że jest w drodze - nadawca mógł
+zarezerwować miejsce i jeszcze nie skończyć mailbox_push */
+static inline mnode_t* mailbox_pop_wait(mailbox_t* mb) {
+    mnode_t* node;
+    for (int spins = 0; (node = mailbox_pop(mb)) == NULL; spins++) {
+        if (spins >= 64)
+            sched_yield();
+    }
+    return node;
+}
+
+/* czy skrzynka żywego aktora z pokolenia gen jest pełna; sekwencyjnie spójny odczyt -
+para z mailbox_release przy czekaniu na miejsce (czekający zapisuje się, potem
+sprawdza; wątek aktora zwalnia miejsce, potem sprawdza, czy ktoś czeka) */
+static inline bool mailbox_full(mailbox_t* mb, uint64_t gen, uint64_t limit) {
+    uint64_t pending = atomic_load_explicit(&mb->pending, memory_order_seq_cst);
+    if ((pending & MAILBOX_DEAD) || (pending >> MAILBOX_GEN_SHIFT) != gen)
+        return false;
+    return (pending & MAILBOX_COUNT_MASK) >= limit;
+}
+
+static inline uint64_t mailbox_count(mailbox_t* mb) {
+    return atomic_load_explicit(&mb->pending, memory_order_acquire) & MAILBOX_COUNT_MASK;
+}
+
+//oznacza aktora jako martwego - od tej chwili mailbox_reserve zwraca -1
+static inline void mailbox_kill(mailbox_t* mb) {
+    atomic_fetch_or_explicit(&mb->pending, MAILBOX_DEAD, memory_order_acq_rel);
+}
+
+/* oznacza jako martwego aktora z pokolenia gen, który nie ma komunikatów (więc
+nikt go nie obsługuje) - jak przetworzenie MSG_GODIE w pustej skrzynce; zwraca 1,
+gdy się udało, 0, gdy aktor ma komunikaty, -1, gdy już nie żyje */
+static inline int mailbox_kill_idle(mailbox_t* mb, uint64_t gen) {
+    uint64_t old = atomic_load_explicit(&mb->pending, memory_order_acquire);
+    do {
+        if ((old & MAILBOX_DEAD) || (old >> MAILBOX_GEN_SHIFT) != gen)
+            return -1;
+        if ((old & MAILBOX_COUNT_MASK) != 0)
+            return 0;
+    } while (!atomic_compare_exchange_weak_explicit(&mb->pending, &old, old | MAILBOX_DEAD,
+                memory_order_acq_rel, memory_order_acquire));
+    return 1;
+}
+
+static inline uint64_t mailbox_generation(mailbox_t* mb) {
+    return atomic_load_explicit(&mb->pending, memory_order_acquire) >> MAILBOX_GEN_SHIFT;
+}
+
+/* skrzynka martwego aktora, którą opróżniono, przechodzi do następnego pokolenia
+(wciąż martwa) - wszystkie stare id przestają do niej pasować */
+static inline void mailbox_retire(mailbox_t* mb) {
+    uint64_t gen = (mailbox_generation(mb) + 1) & MAILBOX_GEN_MASK;
+    atomic_store_explicit(&mb->pending, (gen << MAILBOX_GEN_SHIFT) | MAILBOX_DEAD, memory_order_release);
+}
+
+//odlicza n przetworzonych komunikatów, zwraca nowe słowo pending (patrz mailbox_full)
+static inline uint64_t mailbox_release(mailbox_t* mb, uint64_t n) {
+    return atomic_fetch_sub_explicit(&mb->pending, n, memory_order_seq_cst) - n;
+}
+
+#endif
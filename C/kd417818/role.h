@@ -0,0 +1,96 @@
+#ifndef ROLE_H
+#define ROLE_H
+
+/* role z typowanymi komunikatami, generowane z listy promptów (X-makro): lista
+LIST(P) wymienia prompty jako P(rola, nazwa, typ ładunku), np.
+
+    #define COUNTER_PROMPTS(P) \
+        P(counter, add, add_t) \
+        P(counter, get, get_t)
+
+    ROLE_DECLARE(counter, COUNTER_PROMPTS)   //w nagłówku albo w pliku .c
+    ROLE_DEFINE(counter, COUNTER_PROMPTS)    //w jednym pliku .c, po promptach
+
+ROLE_DECLARE tworzy:
+- typy komunikatów counter_msg_hello (MSG_HELLO), counter_msg_add, ... i ich
+  liczbę counter_nprompts,
+- prototypy promptów, które pisze użytkownik: counter_hello(stateptr, parent)
+  oraz counter_add(stateptr, const add_t *msg) itd. - niezgodna sygnatura to
+  błąd kompilacji,
+- funkcje wysyłające counter_send_add(actor, const add_t *msg) - ładunek jest
+  kopiowany do węzła skrzynki (send_message_inline), więc jego typ musi się tam
+  zmieścić (sprawdzane w czasie kompilacji),
+- extern role_t counter_role.
+
+ROLE_DEFINE tworzy counter_role z gęstą tablicą adapterów (counter_prompts) -
+tak prompty wywołuje system; ROLE_DEFINE_EX(counter, COUNTER_PROMPTS, ...)
+robi to samo, a dalsze argumenty uzupełniają counter_role, np.
+.sched_class = ACTOR_CLASS_HIGH; do tego counter_dispatch: switch po typie z
+bezpośrednimi wywołaniami promptów, które kompilator może wstawić - dla
+miejsc, w których rola jest znana w czasie kompilacji (np. aktor obsługujący
+komunikaty roli, którą zawiera, albo test promptów bez systemu); komunikat
+typu spoza roli albo z nbytes innym niż rozmiar typu ładunku (np. wysłany
+zwykłym send_message bez ładunku) ginie - prompt nie jest wywoływany */
+
+#include "cacti.h"
+
+#define ROLE_ENUM_(role, name, type) role##_msg_##name,
+
+#define ROLE_PROTOTYPE_(role, name, type) \
+    void role##_##name(void **stateptr, const type *msg);
+
+#define ROLE_SENDER_(role, name, type) \
+    _Static_assert(sizeof(type) <= MESSAGE_INLINE_SIZE, \
+                   #role "_" #name ": ladunek wiekszy niz MESSAGE_INLINE_SIZE"); \
+    static inline int role##_send_##name(actor_id_t actor, const type *msg) { \
+        return send_message_inline(actor, role##_msg_##name, msg, sizeof(type)); \
+    }
+
+#define ROLE_DECLARE(role, LIST) \
+    enum role##_msg { role##_msg_hello = MSG_HELLO, LIST(ROLE_ENUM_) role##_nprompts }; \
+    void role##_hello(void **stateptr, actor_id_t parent); \
+    LIST(ROLE_PROTOTYPE_) \
+    LIST(ROLE_SENDER_) \
+    void role##_dispatch(void **stateptr, message_type_t type, size_t nbytes, void *data); \
+    extern role_t role##_role;
+
+#define ROLE_CASE_(role, name, type) \
+    case role##_msg_##name: \
+        if (nbytes == sizeof(type)) \
+            role##_##name(stateptr, (const type *)data); \
+        break;
+
+#define ROLE_ADAPTER_(role, name, type) \
+    static void role##_##name##_act(void **stateptr, size_t nbytes, void *data) { \
+        if (nbytes == sizeof(type)) \
+            role##_##name(stateptr, (const type *)data); \
+    }
+
+#define ROLE_ENTRY_(role, name, type) role##_##name##_act,
+
+#define ROLE_BODY_(role, LIST) \
+    void role##_dispatch(void **stateptr, message_type_t type, size_t nbytes, void *data) { \
+        switch (type) { \
+        case role##_msg_hello: \
+            role##_hello(stateptr, (actor_id_t)data); \
+            break; \
+        LIST(ROLE_CASE_) \
+        } \
+    } \
+    static void role##_hello_act(void **stateptr, size_t nbytes, void *data) { \
+        (void)nbytes; \
+        role##_hello(stateptr, (actor_id_t)data); \
+    } \
+    LIST(ROLE_ADAPTER_) \
+    act_t role##_prompts[role##_nprompts] = { role##_hello_act, LIST(ROLE_ENTRY_) };
+
+#define ROLE_DEFINE(role, LIST) \
+    ROLE_BODY_(role, LIST) \
+    role_t role##_role = { .nprompts = role##_nprompts, .prompts = role##_prompts };
+
+//jak ROLE_DEFINE, z dodatkowymi polami role_t (ISO C przed C23 wymaga choć jednego)
+#define ROLE_DEFINE_EX(role, LIST, ...) \
+    ROLE_BODY_(role, LIST) \
+    role_t role##_role = { .nprompts = role##_nprompts, .prompts = role##_prompts, __VA_ARGS__ };
+
+#endif
@@ -1,112 +1,342 @@
 #include "cacti.h"
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
-//#include <assert.h>
+#include <string.h>
+#include <time.h>
 
-#define MSG_INFO 1
-#define MSG_FACT 2
+/* silnia dowolnej wielkości: aktorzy tworzą drzewo - każdy liść mnoży swój
+przedział czynników, a węzły mnożą wyniki dzieci parami aż do korzenia;
+liści jest tyle, ile wątków, więc aktorów jest mniej niż 2 * wątki
+użycie: silnia [wątki [-t]] (domyślnie POOL_SIZE; -t wypisuje czas na stderr) */
 
-actor_id_t first;
-int64_t n;
+#define MSG_READY 1
+#define MSG_RANGE 2
+#define MSG_RESULT 3
 
-message_t msgGoDie = {
-	.message_type = MSG_GODIE
-};
+/* liczby w systemie o podstawie 10^9 (łatwo je wypisać dziesiętnie), cyfry od
+najmniej znaczącej */
+#define BASE 1000000000u
 
-typedef struct fact {
-	int64_t k;
-	int64_t res;
-	int64_t n;
-} fact_t;
+//poniżej tylu cyfr mnożenie szkolne jest szybsze od Karacuby
+#define KARATSUBA 32
+//przedział najwyżej takiej długości liść mnoży po kolei
+#define LEAF_RUN 32
+
+typedef struct bignum {
+	size_t len;
+	uint32_t d[];
+} bignum_t;
+
+bignum_t* bn_new(size_t len) {
+	bignum_t* b = malloc(sizeof(bignum_t) + len * sizeof(uint32_t));
+	if (b == NULL)
+		exit(1);
+	b->len = len;
+	return b;
+}
+
+void bn_trim(bignum_t* b) {
+	while (b->len > 1 && b->d[b->len - 1] == 0)
+		b->len--;
+}
+
+//r[0..rn) += x[0..xn), wynik mieści się w r
+void add_into(uint32_t* r, size_t rn, const uint32_t* x, size_t xn) {
+	uint32_t carry = 0;
+	size_t i = 0;
+	for (; i < xn; i++) {
+		uint32_t s = r[i] + x[i] + carry;
+		carry = s >= BASE;
+		r[i] = carry ? s - BASE : s;
+	}
+	for (; carry && i < rn; i++) {
+		uint32_t s = r[i] + 1;
+		carry = s >= BASE;
+		r[i] = carry ? 0 : s;
+	}
+}
+
+//r[0..rn) -= x[0..xn), r nie mniejsze od x
+void sub_into(uint32_t* r, size_t rn, const uint32_t* x, size_t xn) {
+	uint32_t borrow = 0;
+	size_t i = 0;
+	for (; i < xn; i++) {
+		uint32_t t = x[i] + borrow;
+		borrow = r[i] < t;
+		r[i] = borrow ? r[i] + BASE - t : r[i] - t;
+	}
+	for (; borrow && i < rn; i++) {
+		borrow = r[i] == 0;
+		r[i] = borrow ? BASE - 1 : r[i] - 1;
+	}
+}
+
+//r[0..xn+1) = x[0..xn) + y[0..yn), xn >= yn
+void add(const uint32_t* x, size_t xn, const uint32_t* y, size_t yn, uint32_t* r) {
+	memcpy(r, x, xn * sizeof(uint32_t));
+	r[xn] = 0;
+	add_into(r, xn + 1, y, yn);
+}
+
+void mul_school(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, uint32_t* r) {
+	memset(r, 0, (an + bn) * sizeof(uint32_t));
+	for (size_t i = 0; i < an; i++) {
+		uint64_t carry = 0;
+		for (size_t j = 0; j < bn; j++) {
+			uint64_t acc = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+			r[i + j] = acc % BASE;
+			carry = acc / BASE;
+		}
+		r[i + bn] = carry;
+	}
+}
+
+//r[0..an+bn) = a * b (Karacuba; mocno niezrównoważone mnożone kawałkami)
+void mul(const uint32_t* a, size_t an, const uint32_t* b, size_t bn, uint32_t* r) {
+	if (an < bn) {
+		const uint32_t* t = a;
+		a = b;
+		b = t;
+		size_t tn = an;
+		an = bn;
+		bn = tn;
+	}
+	if (bn < KARATSUBA) {
+		mul_school(a, an, b, bn, r);
+		return;
+	}
+
+	if (an >= 2 * bn) {
+		memset(r, 0, (an + bn) * sizeof(uint32_t));
+		uint32_t* part = malloc(2 * bn * sizeof(uint32_t));
+		if (part == NULL)
+			exit(1);
+		for (size_t off = 0; off < an; off += bn) {
+			size_t len = an - off < bn ? an - off : bn;
+			mul(a + off, len, b, bn, part);
+			add_into(r + off, an + bn - off, part, len + bn);
+		}
+		free(part);
+		return;
+	}
+
+	//a = a1 * B^m + a0, b = b1 * B^m + b0 (bn > m, bo an < 2 * bn)
+	size_t m = an / 2;
+	size_t rn = an + bn;
+	mul(a, m, b, m, r);
+	mul(a + m, an - m, b + m, bn - m, r + 2 * m);
+
+	size_t san = an - m + 1;
+	size_t sbn = (bn - m > m ? bn - m : m) + 1;
+	uint32_t* sa = malloc((san + sbn + san + sbn) * sizeof(uint32_t));
+	if (sa == NULL)
+		exit(1);
+	uint32_t* sb = sa + san;
+	uint32_t* mid = sb + sbn;
+	add(a + m, an - m, a, m, sa);
+	if (bn - m > m)
+		add(b + m, bn - m, b, m, sb);
+	else
+		add(b, m, b + m, bn - m, sb);
+
+	//a0 * b1 + a1 * b0 = (a0 + a1)(b0 + b1) - a0 * b0 - a1 * b1
+	size_t midn = san + sbn;
+	mul(sa, san, sb, sbn, mid);
+	sub_into(mid, midn, r, 2 * m);
+	sub_into(mid, midn, r + 2 * m, rn - 2 * m);
+	while (midn > 0 && mid[midn - 1] == 0)
+		midn--;
+	add_into(r + m, rn - m, mid, midn);
+	free(sa);
+}
+
+bignum_t* bn_mul(const bignum_t* x, const bignum_t* y) {
+	bignum_t* r = bn_new(x->len + y->len);
+	mul(x->d, x->len, y->d, y->len, r->d);
+	bn_trim(r);
+	return r;
+}
+
+//iloczyn lo * (lo+1) * ... * hi, drzewem (równej wielkości czynniki mnożą się najszybciej)
+bignum_t* range_product(int64_t lo, int64_t hi) {
+	if (hi - lo < LEAF_RUN) {
+		bignum_t* r = bn_new(hi - lo + 2);
+		r->d[0] = 1;
+		r->len = 1;
+		for (int64_t v = lo; v <= hi; v++) {
+			uint64_t carry = 0;
+			for (size_t i = 0; i < r->len; i++) {
+				uint64_t acc = (uint64_t)r->d[i] * v + carry;
+				r->d[i] = acc % BASE;
+				carry = acc / BASE;
+			}
+			if (carry > 0)
+				r->d[r->len++] = carry;
+		}
+		return r;
+	}
+	int64_t mid = lo + (hi - lo) / 2;
+	bignum_t* x = range_product(lo, mid);
+	bignum_t* y = range_product(mid + 1, hi);
+	bignum_t* r = bn_mul(x, y);
+	free(x);
+	free(y);
+	return r;
+}
+
+void bn_print(const bignum_t* b) {
+	printf("%u", b->d[b->len - 1]);
+	for (size_t i = b->len - 1; i-- > 0;)
+		printf("%09u", b->d[i]);
+	printf("\n");
+}
+
+//zlecenie dla aktora: przedział czynników, liczba liści pod nim i komu oddać wynik
+typedef struct range {
+	int64_t lo;
+	int64_t hi;
+	int64_t leaves;
+	actor_id_t parent;
+} range_t;
+
+typedef struct node {
+	range_t range;
+	int children;       //ile dzieci dostało już swój przedział
+	bignum_t* partial;  //wynik pierwszego dziecka, które skończyło
+} node_t;
 
 role_t role;
 
 message_t msgSpawn;
+message_t msgGoDie = {
+	.message_type = MSG_GODIE
+};
+
+bignum_t* result;
+struct timespec finish;
+//aktorzy faktycznie utworzeni - krótkie przedziały nie są dzielone
+_Atomic long actors;
 
 void hello(void** stateptr, size_t size, void* data) {
 	(void)(size);
 	(void)(stateptr);
-	//printf("aktor %ld: dostałem hello od %ld", actor_id_self(), (actor_id_t)(data));
+	atomic_fetch_add_explicit(&actors, 1, memory_order_relaxed);
 	message_t msg = {
-		.message_type = MSG_INFO, //funkcja info
-		.nbytes = sizeof(actor_id_self()),
+		.message_type = MSG_READY,
+		.nbytes = sizeof(actor_id_t),
 		.data = (void*)actor_id_self()
 	};
-	if (actor_id_self() != first)
+	if ((actor_id_t)(data) != -1)
 		send_message((actor_id_t)(data), msg); //wysyłam rodzicowi informacje o sobie
 }
 
-void info(void** stateptr, size_t size, void* data) { //wiadomość od dziecka - zakładam, że mam już silnię policzoną
-	(void)(size);
-	message_t msg = {
-		.message_type = MSG_FACT,
-		.nbytes = sizeof(*stateptr),
-		.data = (void*)(*stateptr)
-	};
-	send_message((actor_id_t)(data), msg);
+//aktor oddaje wynik rodzicowi (korzeń zostawia go dla main) i umiera
+void done(void** stateptr, bignum_t* product) {
+	node_t* node = *stateptr;
+	if (node->range.parent == -1) {
+		result = product;
+		clock_gettime(CLOCK_MONOTONIC, &finish);
+	}
+	else {
+		message_t msg = {
+			.message_type = MSG_RESULT,
+			.nbytes = sizeof(bignum_t*),
+			.data = product
+		};
+		send_message(node->range.parent, msg);
+	}
+	free(node);
+	*stateptr = NULL;
 	send_message(actor_id_self(), msgGoDie);
 }
 
-void fact(void** stateptr, size_t size, void* data) {
-	(void)(size);	
-	*stateptr = (fact_t*)(data);
-	((fact_t*)(*stateptr))->k++;
-	((fact_t*)(*stateptr))->res *= ((fact_t*)(*stateptr))->k;
-
-	//fprintf(stderr, "aktor %ld policzył silnię %d równą %d\n", actor_id_self(), ((fact_t*)(*stateptr))->k, ((fact_t*)(*stateptr))->res);
+void range(void** stateptr, size_t size, void* data) {
+	(void)(size);
+	node_t* node = calloc(1, sizeof(node_t));
+	if (node == NULL)
+		exit(1);
+	node->range = *(range_t*)(data);
+	*stateptr = node;
 
-	if (((fact_t*)(*stateptr))->k < ((fact_t*)(*stateptr))->n) {
-		send_message(actor_id_self(), msgSpawn); //każę sobie zespawnować nowego
-	}
-	else {
-		printf("%ld\n", ((fact_t*)(*stateptr))->res);
-		send_message(actor_id_self(), msgGoDie); //zabijam się
+	if (node->range.leaves <= 1 || node->range.hi - node->range.lo < 2 * LEAF_RUN) {
+		done(stateptr, range_product(node->range.lo, node->range.hi));
+		return;
 	}
-	
+	//połowy przedziału dostaną dzieci, gdy się przywitają
+	send_message(actor_id_self(), msgSpawn);
+	send_message(actor_id_self(), msgSpawn);
 }
 
-int main(){
-	
-	scanf("%ld", &n);
-	if (n < 0) {
-		exit(1);
+void ready(void** stateptr, size_t size, void* data) {
+	(void)(size);
+	node_t* node = *stateptr;
+	range_t* r = &node->range;
+	int64_t mid = r->lo + (r->hi - r->lo) / 2;
+	range_t half = {
+		.lo = node->children == 0 ? r->lo : mid + 1,
+		.hi = node->children == 0 ? mid : r->hi,
+		.leaves = node->children == 0 ? r->leaves / 2 : r->leaves - r->leaves / 2,
+		.parent = actor_id_self()
+	};
+	node->children++;
+	send_message_inline((actor_id_t)(data), MSG_RANGE, &half, sizeof(half));
+}
+
+void product(void** stateptr, size_t size, void* data) {
+	(void)(size);
+	node_t* node = *stateptr;
+	if (node->partial == NULL) {
+		node->partial = data;
+		return;
 	}
-	//assert(n >= 0);
+	bignum_t* r = bn_mul(node->partial, data);
+	free(node->partial);
+	free(data);
+	done(stateptr, r);
+}
 
-	const size_t nprompts = 3;
-    void (**prompts)(void**, size_t, void*) = malloc(sizeof(void*) * nprompts);
-    prompts[MSG_HELLO] = &hello;
-    prompts[MSG_INFO] = &info;
-	prompts[MSG_FACT] = &fact;
-    
-	role.nprompts = nprompts;
-	role.prompts = prompts;
-	
-	int res = actor_system_create(&first, &role);
-	if (res != 0) {
+int main(int argc, char** argv) {
+	int64_t n;
+	//czynniki muszą być cyframi w systemie o podstawie BASE
+	if (scanf("%ld", &n) != 1 || n < 0 || n >= (int64_t)BASE) {
 		exit(1);
 	}
 
-	fact_t begin;
-	begin.k = 0;
-	begin.n = n;
-	begin.res = 1;
-
-	message_t msg = {
-		.message_type = MSG_FACT,
-		.nbytes = sizeof(fact_t*),
-		.data = (void*)(&begin)
-	};
-
+	act_t prompts[] = { hello, ready, range, product };
+	role.nprompts = 4;
+	role.prompts = prompts;
 	msgSpawn.message_type = MSG_SPAWN;
 	msgSpawn.data = &role;
 
-	send_message(first, msg);
+	actor_system_config_t config = {
+		.workers = argc > 1 ? (size_t)atol(argv[1]) : POOL_SIZE
+	};
+	if (config.workers == 0)
+		config.workers = POOL_SIZE;
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	actor_id_t first;
+	if (actor_system_create_ex(&first, &role, &config) != 0) {
+		exit(1);
+	}
+	range_t all = {
+		.lo = 1,
+		.hi = n,
+		.leaves = config.workers,
+		.parent = -1
+	};
+	send_message_inline(first, MSG_RANGE, &all, sizeof(all));
 	actor_system_join(first);
-	free(prompts);
-	//send_message(first, msgGoDie);
-	//actor_system_join(first);
-	//printf(*stateptr[2]);
 
+	if (argc > 2 && strcmp(argv[2], "-t") == 0) {
+		double seconds = (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9;
+		fprintf(stderr, "silnia,workers=%zu,n=%ld,actors=%ld,seconds=%.6f\n", config.workers, n,
+				atomic_load(&actors), seconds);
+	}
+	bn_print(result);
+	free(result);
 	return 0;
 }
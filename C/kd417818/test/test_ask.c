@@ -0,0 +1,355 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sched.h>
+
+//serwer
+#define MSG_DOUBLE 1
+//pośrednik
+#define MSG_QUAD 1
+#define MSG_SERVER 2
+//klient
+#define MSG_START 1
+#define MSG_NOISE 2
+//milczący odbiorca i pytający, który go sprawdza
+#define MSG_IGNORE 1
+#define MSG_BLOCK 2
+#define MSG_UNKNOWN 9
+#define MSG_GO 1
+
+#define ASKS 1000
+//przez pośrednika - każde pytanie to trzy, a pośrednik obsługuje je po kolei
+#define NESTED_ASKS 100
+#define CLIENTS 32
+
+int tests_run = 0;
+
+_Atomic long finished;
+atomic_bool wrong_answer;
+atomic_bool noise_during_ask;
+_Atomic int errors;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+//zwykły aktor odpowiada na pytania
+void double_it(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)data;
+    message_t answer = {.nbytes = 2 * nbytes};
+    if (reply_message(answer) != 0 || reply_message(answer) != -1)
+        atomic_fetch_add(&errors, 1);
+}
+
+act_t server_prompts[] = {hello, double_it};
+role_t server_role = {.nprompts = 2, .prompts = server_prompts};
+
+/* pośrednik sam jest korutynowy - pyta serwer dwa razy, zanim odpowie; w stanie
+id serwera */
+void quad(void **stateptr, size_t nbytes, void *data)
+{
+    (void)data;
+    actor_id_t server = (actor_id_t)*stateptr;
+    message_t question = {.message_type = MSG_DOUBLE, .nbytes = nbytes};
+    message_t answer;
+    if (ask_message(server, question, &answer) != 0)
+        atomic_fetch_add(&errors, 1);
+    question.nbytes = answer.nbytes;
+    if (ask_message(server, question, &answer) != 0)
+        atomic_fetch_add(&errors, 1);
+    reply_message(answer);
+}
+
+void set_server(void **stateptr, size_t nbytes, void *data)
+{
+    (void)nbytes;
+    *stateptr = data;
+}
+
+act_t middle_prompts[] = {hello, quad, set_server};
+role_t middle_role = {.nprompts = 3, .prompts = middle_prompts, .coroutine = true};
+
+/* klient zadaje ASKS pytań w jednym prompcie; komunikat, który przyjdzie w tym
+czasie, czeka, aż prompt się skończy; data to pytany aktor - serwer albo (gdy
+through_middle) pośrednik */
+atomic_bool asking;
+bool through_middle;
+actor_id_t target;
+
+//klient stworzony przez serwer od razu zaczyna, a szum dostaje w trakcie pytań
+void client_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    message_t start = {.message_type = MSG_START, .data = data};
+    message_t noise = {.message_type = MSG_NOISE};
+    send_message(actor_id_self(), start);
+    send_message(actor_id_self(), noise);
+}
+
+void client_start(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    actor_id_t to = (actor_id_t)data;
+    if (!through_middle)
+        atomic_store(&asking, true);
+    message_type_t type = through_middle ? MSG_QUAD : MSG_DOUBLE;
+    size_t asks = through_middle ? NESTED_ASKS : ASKS;
+    for (size_t i = 0; i < asks; i++)
+    {
+        message_t question = {.message_type = type, .nbytes = i};
+        message_t answer;
+        if (ask_message(to, question, &answer) != 0 || answer.nbytes != (through_middle ? 4 : 2) * i)
+            atomic_store(&wrong_answer, true);
+    }
+    atomic_fetch_add(&finished, 1);
+    if (!through_middle)
+    {
+        atomic_store(&asking, false);
+        send_message(to, msg_godie);
+    }
+    send_message(actor_id_self(), msg_godie);
+}
+
+void client_noise(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    if (atomic_load(&asking))
+        atomic_store(&noise_during_ask, true);
+}
+
+role_t swarm_role;
+
+act_t client_prompts[] = {client_hello, client_start, client_noise};
+role_t client_role = {.nprompts = 3, .prompts = client_prompts, .coroutine = true};
+
+//zwykły aktor nie może czekać, a korutynowy - pytać siebie
+void plain_ask(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    message_t answer;
+    message_t question = {.message_type = MSG_DOUBLE};
+    if (ask_message(actor_id_self(), question, &answer) != -5)
+        atomic_fetch_add(&errors, 1);
+    //nie ma pytania, na które można by odpowiedzieć
+    if (reply_message(answer) != -1)
+        atomic_fetch_add(&errors, 1);
+    send_message(actor_id_self(), msg_godie);
+}
+
+act_t plain_prompts[] = {hello, plain_ask};
+role_t plain_role = {.nprompts = 2, .prompts = plain_prompts};
+role_t self_role = {.nprompts = 2, .prompts = plain_prompts, .coroutine = true};
+
+static char *single_worker()
+{
+    //jeden wątek - czekający klient nie może go zająć, bo serwer by nie odpowiedział
+    actor_id_t server;
+    through_middle = false;
+    atomic_store(&finished, 0);
+    atomic_store(&wrong_answer, false);
+    atomic_store(&noise_during_ask, false);
+    atomic_store(&errors, 0);
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&server, &server_role, &config) == 0);
+    message_t spawn = {.message_type = MSG_SPAWN, .data = &client_role};
+    mu_assert("spawn", send_message(server, spawn) == 0);
+    actor_system_join(server);
+
+    mu_assert("finished", atomic_load(&finished) == 1);
+    mu_assert("answers", !atomic_load(&wrong_answer));
+    mu_assert("noise after prompt", !atomic_load(&noise_during_ask));
+    mu_assert("one reply each", atomic_load(&errors) == 0);
+    return 0;
+}
+
+//korzeń roju tworzy pozostałych klientów; każdy od razu zaczyna pytać
+void swarm_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    if ((actor_id_t)data == -1)
+    {
+        message_t spawn = {.message_type = MSG_SPAWN, .data = &swarm_role};
+        for (int i = 1; i < CLIENTS; i++)
+            send_message(actor_id_self(), spawn);
+    }
+    message_t start = {.message_type = MSG_START, .data = (void *)target};
+    send_message(actor_id_self(), start);
+}
+
+act_t swarm_prompts[] = {swarm_hello, client_start, client_noise};
+role_t swarm_role = {.nprompts = 3, .prompts = swarm_prompts, .coroutine = true};
+
+static char *nested_many()
+{
+    //wielu klientów pyta pośrednika, który na każde pytanie dwa razy pyta serwer
+    actor_id_t server, root;
+    through_middle = true;
+    atomic_store(&finished, 0);
+    atomic_store(&wrong_answer, false);
+    atomic_store(&errors, 0);
+    actor_system_config_t config = {.workers = 3};
+    actor_system_t *sys_s, *sys_m;
+    mu_assert("server", actor_system_start(&sys_s, &server, &server_role, &config) == 0);
+    mu_assert("middle", actor_system_start(&sys_m, &target, &middle_role, &config) == 0);
+    message_t set = {.message_type = MSG_SERVER, .data = (void *)server};
+    mu_assert("set server", send_message(target, set) == 0);
+
+    mu_assert("clients", actor_system_create_ex(&root, &swarm_role, &config) == 0);
+    actor_system_join(root);
+    mu_assert("middle godie", send_message(target, msg_godie) == 0);
+    mu_assert("server godie", send_message(server, msg_godie) == 0);
+    actor_system_wait(sys_m);
+    actor_system_wait(sys_s);
+
+    mu_assert("finished", atomic_load(&finished) == CLIENTS);
+    mu_assert("answers", !atomic_load(&wrong_answer));
+    mu_assert("errors", atomic_load(&errors) == 0);
+    return 0;
+}
+
+static char *misuse()
+{
+    actor_id_t actor;
+    atomic_store(&errors, 0);
+    message_t answer;
+    message_t question = {.message_type = MSG_DOUBLE};
+    //spoza puli
+    mu_assert("outside", ask_message(0, question, &answer) == -5);
+    mu_assert("reply outside", reply_message(answer) == -5);
+
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("plain", actor_system_create_ex(&actor, &plain_role, &config) == 0);
+    mu_assert("go", send_message(actor, question) == 0);
+    actor_system_join(actor);
+    mu_assert("self", actor_system_create_ex(&actor, &self_role, &config) == 0);
+    mu_assert("go", send_message(actor, question) == 0);
+    actor_system_join(actor);
+    mu_assert("errors", atomic_load(&errors) == 0);
+    return 0;
+}
+
+//odbiorca, który na pytania nie odpowiada - wraca z promptu albo zajmuje wątek
+atomic_bool released;
+
+void ignore(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+void block(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    while (!atomic_load(&released))
+        sched_yield();
+}
+
+act_t mute_prompts[] = {hello, ignore, block};
+role_t mute_role = {.nprompts = 3, .prompts = mute_prompts};
+
+//pytający: typ pytania w nbytes, pytany w data; wynik ask_message trafia do status
+#define PENDING 1
+_Atomic int status;
+atomic_bool asked;
+
+void ask_go(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    message_t question = {.message_type = (message_type_t)nbytes}, answer;
+    atomic_store(&asked, true);
+    atomic_store(&status, ask_message((actor_id_t)data, question, &answer));
+}
+
+act_t asker_prompts[] = {hello, ask_go};
+role_t asker_role = {.nprompts = 2, .prompts = asker_prompts, .coroutine = true};
+
+static void start_ask(actor_id_t asker, actor_id_t receiver, message_type_t type)
+{
+    atomic_store(&status, PENDING);
+    atomic_store(&asked, false);
+    message_t go = {.message_type = MSG_GO, .nbytes = (size_t)type, .data = (void *)receiver};
+    send_message(asker, go);
+}
+
+static int wait_ask()
+{
+    while (atomic_load(&status) == PENDING)
+        sched_yield();
+    return atomic_load(&status);
+}
+
+//pytanie, na które nikt już nie odpowie, wznawia pytającego z -2
+static char *dropped_questions()
+{
+    actor_system_t *sys_r;
+    actor_id_t receiver, asker;
+    atomic_store(&released, false);
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("receiver", actor_system_start(&sys_r, &receiver, &mute_role, &config) == 0);
+    mu_assert("asker", actor_system_create_ex(&asker, &asker_role, &config) == 0);
+
+    start_ask(asker, receiver, MSG_IGNORE);
+    mu_assert("unanswered", wait_ask() == -2);
+    start_ask(asker, receiver, MSG_UNKNOWN);
+    mu_assert("unknown type", wait_ask() == -2);
+
+    //pytanie czeka za zajętym wątkiem, a system odbiorcy zostaje zatrzymany
+    message_t hold = {.message_type = MSG_BLOCK};
+    mu_assert("block", send_message(receiver, hold) == 0);
+    start_ask(asker, receiver, MSG_IGNORE);
+    while (!atomic_load(&asked))
+        sched_yield();
+    mu_assert("stop", actor_system_shutdown_of(sys_r, SHUTDOWN_NOW, 0) == 1);
+    atomic_store(&released, true);
+    actor_system_wait(sys_r);
+    mu_assert("flushed", wait_ask() == -2);
+
+    mu_assert("godie", send_message(asker, msg_godie) == 0);
+    actor_system_join(asker);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(single_worker);
+    mu_run_test(nested_many);
+    mu_run_test(misuse);
+    mu_run_test(dropped_questions);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
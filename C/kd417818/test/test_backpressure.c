@@ -0,0 +1,194 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sched.h>
+
+//konsumenci
+#define MSG_ITEM 1
+//producent
+#define MSG_READY 1
+#define MSG_PROBE 2
+
+#define ITEMS 200
+#define SMALL_LIMIT 4
+//więcej niż domyślny limit skrzynki
+#define BIG_LIMIT (4 * ACTOR_QUEUE_LIMIT)
+
+int tests_run = 0;
+
+atomic_bool release_hello;
+_Atomic long received;
+atomic_bool in_order;
+_Atomic long received_at_probe;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    while (!atomic_load(&release_hello))
+        sched_yield();
+}
+
+//komunikaty mają przychodzić po kolei (nbytes to numer)
+void item(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)data;
+    if ((long)nbytes != atomic_fetch_add(&received, 1))
+        atomic_store(&in_order, false);
+}
+
+act_t prompts[] = {hello, item};
+role_t role = {.nprompts = 2, .prompts = prompts};
+role_t big_role = {.nprompts = 2, .prompts = prompts, .mailbox_limit = BIG_LIMIT};
+
+//konsument z małą skrzynką przedstawia się producentowi
+void consumer_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    message_t msg = {.message_type = MSG_READY, .data = (void *)actor_id_self()};
+    send_message((actor_id_t)data, msg);
+}
+
+act_t consumer_prompts[] = {consumer_hello, item};
+role_t consumer_role = {.nprompts = 2, .prompts = consumer_prompts, .mailbox_limit = SMALL_LIMIT};
+
+void producer_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    message_t spawn = {.message_type = MSG_SPAWN, .data = &consumer_role};
+    send_message(actor_id_self(), spawn);
+}
+
+//wszystko naraz - skrzynka konsumenta dawno się zapełni
+void producer_ready(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    actor_id_t consumer = (actor_id_t)data;
+    for (long i = 0; i < ITEMS; i++)
+    {
+        message_t msg = {.message_type = MSG_ITEM, .nbytes = i};
+        send_message_wait(consumer, msg);
+    }
+    send_message_wait(consumer, msg_godie);
+    message_t probe = {.message_type = MSG_PROBE};
+    send_message(actor_id_self(), probe);
+    send_message(actor_id_self(), msg_godie);
+}
+
+//wstrzymany producent nie dostaje komunikatów, dopóki nie dostarczy wszystkich
+void producer_probe(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_store(&received_at_probe, atomic_load(&received));
+}
+
+act_t producer_prompts[] = {producer_hello, producer_ready, producer_probe};
+role_t producer_role = {.nprompts = 3, .prompts = producer_prompts};
+
+static char *blocking_send()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, false);
+    atomic_store(&received, 0);
+    atomic_store(&in_order, true);
+    actor_system_config_t config = {.workers = 1, .mailbox_limit = SMALL_LIMIT};
+    mu_assert("create", actor_system_create_ex(&actor, &role, &config) == 0);
+
+    //aktor wisi w hello, więc skrzynka się zapełnia
+    message_t msg = {.message_type = MSG_ITEM};
+    long sent = 0;
+    for (msg.nbytes = sent; send_message(actor, msg) == 0; msg.nbytes = ++sent) {}
+    mu_assert("full", sent < ITEMS);
+
+    //send_message_wait poczeka, aż aktor zwolni miejsce
+    atomic_store(&release_hello, true);
+    for (long i = sent; i < ITEMS; i++)
+    {
+        msg.nbytes = i;
+        mu_assert("blocking send", send_message_wait(actor, msg) == 0);
+    }
+    mu_assert("godie", send_message_wait(actor, msg_godie) == 0);
+    actor_system_join(actor);
+
+    mu_assert("all received", atomic_load(&received) == ITEMS);
+    mu_assert("in order", atomic_load(&in_order));
+    return 0;
+}
+
+static char *suspended_actor()
+{
+    actor_id_t actor;
+    atomic_store(&received, 0);
+    atomic_store(&in_order, true);
+    atomic_store(&received_at_probe, -1);
+    //jeden wątek - zablokowany producent zablokowałby też konsumenta
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&actor, &producer_role, &config) == 0);
+    actor_system_join(actor);
+
+    mu_assert("all received", atomic_load(&received) == ITEMS);
+    mu_assert("in order", atomic_load(&in_order));
+    //w skrzynce konsumenta mogło zostać najwyżej SMALL_LIMIT ostatnich
+    mu_assert("probe after flush", atomic_load(&received_at_probe) >= ITEMS - SMALL_LIMIT);
+    return 0;
+}
+
+static char *role_capacity()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, false);
+    atomic_store(&received, 0);
+    atomic_store(&in_order, true);
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&actor, &big_role, &config) == 0);
+
+    message_t msg = {.message_type = MSG_ITEM, .nbytes = 0};
+    while (send_message(actor, msg) == 0)
+        msg.nbytes++;
+    //jak w test_config: hello zajmuje jedno miejsce
+    mu_assert("role limit", (long)msg.nbytes == BIG_LIMIT - 1);
+
+    atomic_store(&release_hello, true);
+    mu_assert("godie", send_message_wait(actor, msg_godie) == 0);
+    actor_system_join(actor);
+    mu_assert("dead refused", send_message_wait(actor, msg) < 0);
+    mu_assert("all received", atomic_load(&received) == BIG_LIMIT - 1);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(blocking_send);
+    mu_run_test(suspended_actor);
+    mu_run_test(role_capacity);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
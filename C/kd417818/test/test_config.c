@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sched.h>
+
+int tests_run = 0;
+
+atomic_bool release_hello;
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    while (!atomic_load(&release_hello))
+        sched_yield();
+}
+
+void nothing(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+act_t prompts[] = {hello, nothing};
+role_t role = {.nprompts = 2, .prompts = prompts};
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+static char *mailbox_limit()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, false);
+    actor_system_config_t config = {.workers = 2, .mailbox_limit = 8};
+    mu_assert("create", actor_system_create_ex(&actor, &role, &config) == 0);
+
+    message_t msg = {.message_type = 1};
+    int accepted = 0;
+    while (send_message(actor, msg) == 0)
+        accepted++;
+    mu_assert("configured limit", accepted == 7);
+
+    atomic_store(&release_hello, true);
+    while (send_message(actor, msg_godie) == -3)
+        sched_yield();
+    actor_system_join(actor);
+    return 0;
+}
+
+static char *pinned_workers()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, true);
+
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed))
+        cpu++;
+
+    int cpus[] = {cpu, -1, cpu};
+    actor_system_config_t config = {.workers = 3, .cpus = cpus};
+    mu_assert("create pinned", actor_system_create_ex(&actor, &role, &config) == 0);
+    mu_assert("godie", send_message(actor, msg_godie) == 0);
+    actor_system_join(actor);
+
+    int bad[] = {CPU_SETSIZE + 1};
+    config.workers = 1;
+    config.cpus = bad;
+    mu_assert("bad cpu rejected", actor_system_create_ex(&actor, &role, &config) == -5);
+
+    int no_node[] = {1 << 20};
+    config.cpus = NULL;
+    config.numa_nodes = no_node;
+    mu_assert("bad numa node rejected", actor_system_create_ex(&actor, &role, &config) == -5);
+    return 0;
+}
+
+static char *default_workers()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, true);
+    mu_assert("create default", actor_system_create_ex(&actor, &role, NULL) == 0);
+    mu_assert("second system refused", actor_system_create(&actor, &role) == -1);
+    mu_assert("godie", send_message(actor, msg_godie) == 0);
+    actor_system_join(actor);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(mailbox_limit);
+    mu_run_test(pinned_workers);
+    mu_run_test(default_workers);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
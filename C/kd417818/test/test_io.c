@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include "minunit.h"
+#include "cacti.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MSG_READABLE 1
+#define MSG_READY 2
+#define MSG_START 3
+#define MSG_TIMER 4
+
+//więcej niż mieści potok - piszący czeka, aż czytający aktor zrobi miejsce
+#define PIPE_BYTES (1 << 20)
+#define ROUND_TRIPS 1000
+#define MS 1000000ul
+
+int tests_run = 0;
+
+_Atomic long bytes_read;
+atomic_bool eof;
+_Atomic long round_trips;
+int sv[2];
+_Atomic uint64_t timer_at;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+//czyta, ile się da; koniec potoku kończy obserwację i aktora
+void pipe_readable(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    int fd = (int)(intptr_t)data;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        atomic_fetch_add(&bytes_read, n);
+    if (n == 0)
+    {
+        atomic_store(&eof, true);
+        io_unwatch(fd);
+        close(fd);
+        send_message(actor_id_self(), msg_godie);
+        return;
+    }
+    io_rearm(fd, IO_READ);
+}
+
+act_t pipe_prompts[] = {hello, pipe_readable};
+role_t pipe_role = {.nprompts = 2, .prompts = pipe_prompts};
+
+/* odbijanie bajtu przez parę gniazd: korzeń (sv[0]) i dziecko (sv[1]); w
+stanie aktora jego koniec pary */
+void pong_readable(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    int fd = (int)(intptr_t)data;
+    char c;
+    if ((nbytes & IO_HUP) || read(fd, &c, 1) != 1)
+    {
+        io_unwatch(fd);
+        send_message(actor_id_self(), msg_godie);
+        return;
+    }
+    //korzeń liczy odbicia i w końcu zamyka swój koniec - dziecko zobaczy IO_HUP
+    if (fd == sv[0] && atomic_fetch_add(&round_trips, 1) + 1 == ROUND_TRIPS)
+    {
+        io_unwatch(fd);
+        shutdown(fd, SHUT_RDWR);
+        send_message(actor_id_self(), msg_godie);
+        return;
+    }
+    if (write(fd, &c, 1) != 1)
+        atomic_store(&round_trips, -1000000);
+    io_rearm(fd, IO_READ);
+}
+
+role_t pong_role;
+
+void pong_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    if ((actor_id_t)data == -1)
+    {
+        message_t spawn = {.message_type = MSG_SPAWN, .data = &pong_role};
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    message_t ready = {.message_type = MSG_READY, .data = (void *)actor_id_self()};
+    send_message((actor_id_t)data, ready);
+}
+
+//dziecko gotowe - oba końce pod obserwacją, korzeń wysyła pierwszy bajt
+void pong_ready(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    message_t start = {.message_type = MSG_START};
+    send_message((actor_id_t)data, start);
+    io_watch(actor_id_self(), sv[0], IO_READ, MSG_READABLE);
+    char c = 'x';
+    if (write(sv[0], &c, 1) != 1)
+        atomic_store(&round_trips, -1000000);
+}
+
+void pong_start(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    io_watch(actor_id_self(), sv[1], IO_READ, MSG_READABLE);
+}
+
+act_t pong_prompts[] = {pong_hello, pong_readable, pong_ready, pong_start};
+role_t pong_role = {.nprompts = 4, .prompts = pong_prompts};
+
+void on_timer(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_store(&timer_at, now_ns());
+}
+
+act_t timer_prompts[] = {hello, pipe_readable, hello, hello, on_timer};
+role_t timer_role = {.nprompts = 5, .prompts = timer_prompts};
+
+static char *pipe_reader()
+{
+    actor_id_t actor;
+    atomic_store(&bytes_read, 0);
+    atomic_store(&eof, false);
+    int fds[2];
+    mu_assert("pipe", pipe(fds) == 0);
+    mu_assert("nonblocking", fcntl(fds[0], F_SETFL, O_NONBLOCK) == 0);
+
+    //jeden wątek - blokujący read w prompcie zatrzymałby cały system
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&actor, &pipe_role, &config) == 0);
+    mu_assert("watch", io_watch(actor, fds[0], IO_READ, MSG_READABLE) == 0);
+    mu_assert("watched twice", io_watch(actor, fds[0], IO_READ, MSG_READABLE) == -5);
+
+    char buf[8192];
+    memset(buf, 'a', sizeof(buf));
+    for (long left = PIPE_BYTES; left > 0;)
+    {
+        ssize_t n = write(fds[1], buf, left < (long)sizeof(buf) ? (size_t)left : sizeof(buf));
+        mu_assert("write", n > 0);
+        left -= n;
+    }
+    close(fds[1]);
+    actor_system_join(actor);
+
+    mu_assert("all read", atomic_load(&bytes_read) == PIPE_BYTES);
+    mu_assert("eof", atomic_load(&eof));
+    return 0;
+}
+
+static char *socket_ping_pong()
+{
+    actor_id_t actor;
+    atomic_store(&round_trips, 0);
+    mu_assert("socketpair", socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0);
+
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&actor, &pong_role, &config) == 0);
+    actor_system_join(actor);
+    close(sv[0]);
+    close(sv[1]);
+
+    mu_assert("round trips", atomic_load(&round_trips) == ROUND_TRIPS);
+    return 0;
+}
+
+static char *timer_while_polling()
+{
+    actor_id_t actor;
+    atomic_store(&timer_at, 0);
+    int fds[2];
+    mu_assert("pipe", pipe2(fds, O_NONBLOCK) == 0);
+
+    //wątki śpią w epoll_wait na cichym potoku - zegar i tak musi je obudzić
+    actor_system_config_t config = {.workers = 2};
+    mu_assert("create", actor_system_create_ex(&actor, &timer_role, &config) == 0);
+    mu_assert("watch", io_watch(actor, fds[0], IO_READ, MSG_READABLE) == 0);
+    uint64_t start = now_ns();
+    message_t timer = {.message_type = MSG_TIMER};
+    mu_assert("after", send_message_after(actor, timer, 20 * MS, NULL) == 0);
+    while (atomic_load(&timer_at) == 0)
+        ;
+    mu_assert("not early", atomic_load(&timer_at) - start >= 20 * MS);
+
+    mu_assert("bad fd", io_watch(actor, -1, IO_READ, MSG_READABLE) == -4);
+    mu_assert("unwatch", io_unwatch(fds[0]) == 0);
+    mu_assert("unwatch twice", io_unwatch(fds[0]) == -1);
+    mu_assert("rearm unwatched", io_rearm(fds[0], IO_READ) == -1);
+    mu_assert("godie", send_message(actor, msg_godie) == 0);
+    actor_system_join(actor);
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(pipe_reader);
+    mu_run_test(socket_ping_pong);
+    mu_run_test(timer_while_polling);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
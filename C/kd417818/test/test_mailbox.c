@@ -0,0 +1,234 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sched.h>
+
+#define MSG_COUNT 1
+
+int tests_run = 0;
+
+atomic_bool release_hello;
+_Atomic long counted;
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    //trzyma wątek, dopóki test nie zapełni skrzynki
+    while (!atomic_load(&release_hello))
+        sched_yield();
+}
+
+void count(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    atomic_fetch_add(&counted, (long)(intptr_t)data);
+}
+
+//ładunek wysyłany w węźle - sprawdza, że to kopia z chwili wysłania
+void check_payload(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    long sum = 0;
+    for (size_t i = 0; i < nbytes / sizeof(long); i++)
+        sum += ((long *)data)[i];
+    atomic_fetch_add(&counted, nbytes == MESSAGE_INLINE_SIZE ? sum : -1000000);
+}
+
+shared_buf_t *broadcast;
+
+//wspólny bufor dochodzi bez kopiowania
+void check_shared(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    bool same = shared_buf_of(data) == broadcast && nbytes == shared_buf_size(broadcast);
+    atomic_fetch_add(&counted, same ? ((long *)data)[nbytes / sizeof(long) - 1] : -1000000);
+}
+
+act_t prompts[] = {hello, count, check_payload, check_shared};
+role_t role = {.nprompts = 4, .prompts = prompts};
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+static char *full_mailbox()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, false);
+    atomic_store(&counted, 0);
+    mu_assert("create", actor_system_create(&actor, &role) == 0);
+
+    message_t msg = {.message_type = MSG_COUNT, .data = (void *)1};
+    long accepted = 0;
+    int err;
+    while ((err = send_message(actor, msg)) == 0)
+        accepted++;
+
+    //MSG_HELLO zajmuje jedno miejsce, dopóki nie zostanie przetworzony
+    mu_assert("full mailbox returns -3", err == -3);
+    mu_assert("limit", accepted == ACTOR_QUEUE_LIMIT - 1);
+
+    atomic_store(&release_hello, true);
+    while (send_message(actor, msg_godie) == -3)
+        sched_yield();
+    actor_system_join(actor);
+
+    mu_assert("all delivered", atomic_load(&counted) == accepted);
+    return 0;
+}
+
+static char *dead_actor()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, true);
+    atomic_store(&counted, 0);
+    mu_assert("create", actor_system_create(&actor, &role) == 0);
+
+    message_t msg = {.message_type = MSG_COUNT, .data = (void *)1};
+    mu_assert("godie", send_message(actor, msg_godie) == 0);
+
+    //po przetworzeniu MSG_GODIE aktor odrzuca komunikaty
+    int err;
+    while ((err = send_message(actor, msg)) == 0)
+        sched_yield();
+    mu_assert("dead actor returns -1", err == -1);
+    mu_assert("bad id returns -2", send_message(actor + 1, msg) == -2);
+    actor_system_join(actor);
+    return 0;
+}
+
+static char *batched_send()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, false);
+    atomic_store(&counted, 0);
+    mu_assert("create", actor_system_create(&actor, &role) == 0);
+
+    static message_t msgs[ACTOR_QUEUE_LIMIT + 16];
+    for (size_t i = 0; i < ACTOR_QUEUE_LIMIT + 16; i++)
+    {
+        msgs[i].message_type = MSG_COUNT;
+        msgs[i].data = (void *)(intptr_t)(i + 1);
+    }
+
+    //skrzynka zapełnia się w trakcie - przyjęty jest tylko początek
+    mu_assert("first part", send_messages(actor, msgs, 10) == 10);
+    mu_assert("partial", send_messages(actor, msgs + 10, ACTOR_QUEUE_LIMIT) == ACTOR_QUEUE_LIMIT - 11);
+    mu_assert("full", send_messages(actor, msgs, 1) == -3);
+
+    atomic_store(&release_hello, true);
+    while (send_message(actor, msg_godie) == -3)
+        sched_yield();
+    actor_system_join(actor);
+
+    long n = ACTOR_QUEUE_LIMIT - 1;
+    mu_assert("none lost", atomic_load(&counted) == n * (n + 1) / 2);
+    return 0;
+}
+
+static char *multicast()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, true);
+    atomic_store(&counted, 0);
+    mu_assert("create", actor_system_create(&actor, &role) == 0);
+
+    actor_id_t targets[] = {actor, actor + 7, actor};
+    message_t msg = {.message_type = MSG_COUNT, .data = (void *)5};
+    mu_assert("unknown actor skipped", send_multicast(targets, 3, msg) == 2);
+
+    while (send_message(actor, msg_godie) == -3)
+        sched_yield();
+    actor_system_join(actor);
+    mu_assert("delivered twice", atomic_load(&counted) == 10);
+    return 0;
+}
+
+static char *inline_payload()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, false);
+    atomic_store(&counted, 0);
+    mu_assert("create", actor_system_create(&actor, &role) == 0);
+
+    long payload[MESSAGE_INLINE_SIZE / sizeof(long)];
+    for (int round = 1; round <= 3; round++)
+    {
+        for (size_t i = 0; i < MESSAGE_INLINE_SIZE / sizeof(long); i++)
+            payload[i] = round;
+        mu_assert("sent", send_message_inline(actor, 2, payload, sizeof(payload)) == 0);
+    }
+    //nadpisanie bufora nadawcy nie zmienia wysłanych komunikatów
+    payload[0] = 1000;
+
+    char too_big[MESSAGE_INLINE_SIZE + 1];
+    mu_assert("too big returns -5", send_message_inline(actor, 2, too_big, sizeof(too_big)) == -5);
+
+    atomic_store(&release_hello, true);
+    while (send_message(actor, msg_godie) == -3)
+        sched_yield();
+    actor_system_join(actor);
+
+    long per_round = MESSAGE_INLINE_SIZE / sizeof(long);
+    mu_assert("copied payloads", atomic_load(&counted) == per_round * (1 + 2 + 3));
+    return 0;
+}
+
+static char *shared_payload()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, true);
+    atomic_store(&counted, 0);
+    mu_assert("create", actor_system_create(&actor, &role) == 0);
+
+    size_t n = 1 << 20;
+    broadcast = shared_buf_create(n * sizeof(long));
+    mu_assert("buffer", broadcast != NULL);
+    long *values = shared_buf_data(broadcast);
+    for (size_t i = 0; i < n; i++)
+        values[i] = (long)i;
+
+    actor_id_t targets[] = {actor, actor + 7, actor};
+    mu_assert("multicast", send_multicast_shared(targets, 3, 3, broadcast) == 2);
+    mu_assert("single", send_shared(actor, 3, broadcast) == 0);
+    //twórca oddaje swoją referencję - bufor żyje, dopóki komunikaty czekają
+    shared_buf_release(broadcast);
+
+    while (send_message(actor, msg_godie) == -3)
+        sched_yield();
+    actor_system_join(actor);
+    mu_assert("delivered three times", atomic_load(&counted) == 3 * (long)(n - 1));
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(full_mailbox);
+    mu_run_test(dead_actor);
+    mu_run_test(batched_send);
+    mu_run_test(multicast);
+    mu_run_test(inline_payload);
+    mu_run_test(shared_payload);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
@@ -0,0 +1,185 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sched.h>
+
+//test budowany z CAST_LIMIT 16 (patrz CMakeLists.txt)
+#define SLOT(id) ((id) & 0xffffffffL)
+
+#define MSG_NOTHING 1
+#define MSG_DONE 1
+#define MSG_SPAWN_ONE 2
+
+#define CHAIN 100
+
+int tests_run = 0;
+
+_Atomic long hellos;
+_Atomic actor_id_t children[CHAIN];
+atomic_bool die_at_once;
+long spawned;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+void child_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    actor_id_t self = actor_id_self();
+    atomic_store(&children[atomic_fetch_add(&hellos, 1)], self);
+    if (atomic_load(&die_at_once))
+    {
+        send_message(self, msg_godie);
+        message_t done = {.message_type = MSG_DONE, .data = (void *)self};
+        send_message((actor_id_t)data, done);
+    }
+}
+
+void nothing(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+act_t child_prompts[] = {child_hello, nothing};
+role_t child_role = {.nprompts = 2, .prompts = child_prompts};
+
+message_t msg_spawn = {.message_type = MSG_SPAWN, .data = &child_role};
+
+//aktor tworzy dzieci po jednym - następne dopiero, gdy poprzednie umiera
+void chain_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    spawned = 0;
+    send_message(actor_id_self(), msg_spawn);
+}
+
+void chain_done(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    if (++spawned < CHAIN)
+        send_message(actor_id_self(), msg_spawn);
+    else
+        send_message(actor_id_self(), msg_godie);
+}
+
+act_t chain_prompts[] = {chain_hello, chain_done};
+role_t chain_role = {.nprompts = 2, .prompts = chain_prompts};
+
+//aktor tworzy naraz więcej dzieci, niż pozwala limit
+void crowd_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    for (int i = 0; i < 20; i++)
+        send_message(actor_id_self(), msg_spawn);
+}
+
+void spawn_one(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    send_message(actor_id_self(), msg_spawn);
+}
+
+act_t crowd_prompts[] = {crowd_hello, nothing, spawn_one};
+role_t crowd_role = {.nprompts = 3, .prompts = crowd_prompts};
+
+static char *reused_slots()
+{
+    actor_id_t actor;
+    atomic_store(&hellos, 0);
+    atomic_store(&die_at_once, true);
+    mu_assert("create", actor_system_create(&actor, &chain_role) == 0);
+    actor_system_join(actor);
+
+    //stworzono więcej aktorów, niż wynosi limit - miejsca wracają do użytku
+    mu_assert("all spawned", spawned == CHAIN && atomic_load(&hellos) == CHAIN);
+    bool reused = false;
+    for (int i = 0; i < CHAIN; i++)
+    {
+        actor_id_t id = atomic_load(&children[i]);
+        mu_assert("slot within limit", SLOT(id) < CAST_LIMIT);
+        if (id != SLOT(id))
+            reused = true;
+        for (int j = 0; j < i; j++)
+            mu_assert("ids unique", atomic_load(&children[j]) != id);
+    }
+    mu_assert("new generation", reused);
+    return 0;
+}
+
+static char *live_limit()
+{
+    actor_id_t actor;
+    atomic_store(&hellos, 0);
+    atomic_store(&die_at_once, false);
+    mu_assert("create", actor_system_create(&actor, &crowd_role) == 0);
+
+    //razem z rodzicem żyje CAST_LIMIT aktorów, reszta się nie tworzy
+    while (atomic_load(&hellos) < CAST_LIMIT - 1)
+        sched_yield();
+
+    message_t msg = {.message_type = MSG_NOTHING};
+    actor_id_t victim = atomic_load(&children[0]);
+    mu_assert("godie", send_message(victim, msg_godie) == 0);
+
+    //po śmierci i odzyskaniu miejsca można stworzyć następnego aktora
+    message_t msg_spawn_one = {.message_type = MSG_SPAWN_ONE};
+    while (atomic_load(&hellos) < CAST_LIMIT)
+    {
+        send_message(actor, msg_spawn_one);
+        sched_yield();
+    }
+
+    actor_id_t heir = atomic_load(&children[CAST_LIMIT - 1]);
+    mu_assert("same slot", SLOT(heir) == SLOT(victim));
+    mu_assert("new id", heir != victim);
+    mu_assert("stale id returns -1", send_message(victim, msg) == -1);
+    mu_assert("heir alive", send_message(heir, msg) == 0);
+
+    //rodzic najpierw - zaległe MSG_SPAWN_ONE nie stworzą już nikogo na zwolnionych miejscach
+    send_message(actor, msg_godie);
+    while (send_message(actor, msg) != -1)
+        sched_yield();
+    for (int i = 1; i < CAST_LIMIT; i++)
+        send_message(atomic_load(&children[i]), msg_godie);
+    actor_system_join(actor);
+
+    mu_assert("no more than the limit", atomic_load(&hellos) == CAST_LIMIT);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(reused_slots);
+    mu_run_test(live_limit);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
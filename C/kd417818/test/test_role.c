@@ -0,0 +1,129 @@
+#include "minunit.h"
+#include "role.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define ADDS 1000
+
+int tests_run = 0;
+
+typedef struct add
+{
+    long value;
+} add_t;
+
+typedef struct done
+{
+    long check; //ile razy dodano
+} done_t;
+
+//licznik sumuje ładunki w stanie aktora (sam wskaźnik stanu jest liczbą)
+#define COUNTER_PROMPTS(P) \
+    P(counter, add, add_t) \
+    P(counter, done, done_t)
+
+ROLE_DECLARE(counter, COUNTER_PROMPTS)
+
+_Atomic long sum;
+_Atomic long adds;
+_Atomic long parent;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+void counter_hello(void **stateptr, actor_id_t from)
+{
+    *stateptr = (void *)0;
+    atomic_store(&parent, from);
+}
+
+void counter_add(void **stateptr, const add_t *msg)
+{
+    *stateptr = (void *)((intptr_t)*stateptr + msg->value);
+    atomic_fetch_add(&adds, 1);
+}
+
+void counter_done(void **stateptr, const done_t *msg)
+{
+    if (msg->check == atomic_load(&adds))
+        atomic_store(&sum, (intptr_t)*stateptr);
+    send_message(actor_id_self(), msg_godie);
+}
+
+ROLE_DEFINE_EX(counter, COUNTER_PROMPTS, .mailbox_limit = 2 * ADDS)
+
+//komunikaty złych typów albo rozmiarów giną bez wywołania czegokolwiek
+static char *typed_messages()
+{
+    actor_id_t actor;
+    mu_assert("types", counter_msg_hello == MSG_HELLO && counter_msg_add == 1 && counter_nprompts == 3);
+    mu_assert("extra fields", counter_role.mailbox_limit == 2 * ADDS);
+    atomic_store(&sum, -1);
+    atomic_store(&adds, 0);
+    atomic_store(&parent, 0);
+    actor_system_config_t config = {.workers = 2};
+    mu_assert("create", actor_system_create_ex(&actor, &counter_role, &config) == 0);
+
+    long expected = 0;
+    for (long i = 0; i < ADDS; i++)
+    {
+        add_t add = {.value = i};
+        mu_assert("add", counter_send_add(actor, &add) == 0);
+        expected += i;
+    }
+    message_t bad = {.message_type = counter_nprompts};
+    mu_assert("past prompts", send_message(actor, bad) == 0);
+    bad.message_type = -1;
+    mu_assert("negative", send_message(actor, bad) == 0);
+    //typ roli, ale bez ładunku - prompt dostałby NULL
+    message_t empty = {.message_type = counter_msg_add};
+    mu_assert("no payload", send_message(actor, empty) == 0);
+    done_t done = {.check = ADDS};
+    mu_assert("done", counter_send_done(actor, &done) == 0);
+    actor_system_join(actor);
+
+    mu_assert("hello", atomic_load(&parent) == -1);
+    mu_assert("sum", atomic_load(&sum) == expected);
+    return 0;
+}
+
+//prompty wywołane wprost, bez systemu
+static char *direct_dispatch()
+{
+    void *state = NULL;
+    add_t add = {.value = 5};
+    atomic_store(&adds, 0);
+    counter_dispatch(&state, counter_msg_hello, sizeof(actor_id_t), (void *)7);
+    mu_assert("hello", atomic_load(&parent) == 7);
+    counter_dispatch(&state, counter_msg_add, sizeof(add), &add);
+    counter_dispatch(&state, counter_msg_add, sizeof(add), &add);
+    counter_dispatch(&state, counter_nprompts, sizeof(add), &add);
+    counter_dispatch(&state, counter_msg_add, 0, NULL);
+    counter_dispatch(&state, counter_msg_add, sizeof(add) + 1, &add);
+    mu_assert("state", (intptr_t)state == 10 && atomic_load(&adds) == 2);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(typed_messages);
+    mu_run_test(direct_dispatch);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
@@ -0,0 +1,177 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sched.h>
+
+//test budowany z CACTI_STATS (patrz CMakeLists.txt)
+#define MSG_SPIN 1
+
+#define BULK 50
+//kilka aktywacji tła (jedna przetwarza najwyżej ACTOR_FAIRNESS_BUDGET komunikatów)
+#define BACKGROUND_GOAL (4 * ACTOR_FAIRNESS_BUDGET)
+
+int tests_run = 0;
+
+_Atomic long hellos;
+_Atomic long high_position;
+atomic_bool stop;
+_Atomic long background_count;
+_Atomic long high_count;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+//przywitanie zapisuje, którym z kolei był aktor
+void bulk_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_fetch_add(&hellos, 1);
+    send_message(actor_id_self(), msg_godie);
+}
+
+void high_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_store(&high_position, atomic_fetch_add(&hellos, 1));
+    send_message(actor_id_self(), msg_godie);
+}
+
+act_t bulk_prompts[] = {bulk_hello};
+role_t bulk_role = {.nprompts = 1, .prompts = bulk_prompts, .sched_class = ACTOR_CLASS_BACKGROUND};
+act_t high_prompts[] = {high_hello};
+role_t high_role = {.nprompts = 1, .prompts = high_prompts, .sched_class = ACTOR_CLASS_HIGH};
+
+//korzeń tworzy naraz wielu aktorów w tle, a na końcu jednego ważnego
+void spawner_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    message_t bulk = {.message_type = MSG_SPAWN, .data = &bulk_role};
+    message_t high = {.message_type = MSG_SPAWN, .data = &high_role};
+    for (int i = 0; i < BULK; i++)
+        send_message(actor_id_self(), bulk);
+    send_message(actor_id_self(), high);
+    send_message(actor_id_self(), msg_godie);
+}
+
+act_t spawner_prompts[] = {spawner_hello};
+role_t spawner_role = {.nprompts = 1, .prompts = spawner_prompts};
+
+//aktor, który cały czas ma coś w skrzynce - wysyła sobie kolejne komunikaty
+void spin(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    _Atomic long *count = data;
+    atomic_fetch_add(count, 1);
+    message_t msg = {.message_type = MSG_SPIN, .data = data};
+    send_message(actor_id_self(), atomic_load(&stop) ? msg_godie : msg);
+}
+
+void spin_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+act_t spin_prompts[] = {spin_hello, spin};
+role_t high_spin_role = {.nprompts = 2, .prompts = spin_prompts, .sched_class = ACTOR_CLASS_HIGH};
+role_t background_spin_role = {.nprompts = 2, .prompts = spin_prompts, .sched_class = ACTOR_CLASS_BACKGROUND};
+
+void spin_spawner_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    message_t high = {.message_type = MSG_SPAWN, .data = &high_spin_role};
+    message_t background = {.message_type = MSG_SPAWN, .data = &background_spin_role};
+    //najpierw kilku ważnych - zawsze któryś z nich jest gotowy
+    for (int i = 0; i < 4; i++)
+        send_message(actor_id_self(), high);
+    send_message(actor_id_self(), background);
+    send_message(actor_id_self(), msg_godie);
+}
+
+act_t spin_spawner_prompts[] = {spin_spawner_hello};
+role_t spin_spawner_role = {.nprompts = 1, .prompts = spin_spawner_prompts};
+
+static char *high_first()
+{
+    actor_id_t actor;
+    atomic_store(&hellos, 0);
+    atomic_store(&high_position, -1);
+    //jeden wątek - kolejność uruchomień zależy tylko od szeregowania
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&actor, &spawner_role, &config) == 0);
+    actor_system_join(actor);
+
+    mu_assert("all spawned", atomic_load(&hellos) == BULK + 1);
+    //ważny aktor wyprzedza czekających w tle (najwyżej jeden wybór przypada tłu)
+    mu_assert("high class first", atomic_load(&high_position) <= 1);
+    return 0;
+}
+
+static char *no_starvation()
+{
+    actor_id_t actor;
+    atomic_store(&stop, false);
+    atomic_store(&background_count, 0);
+    atomic_store(&high_count, 0);
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&actor, &spin_spawner_role, &config) == 0);
+
+    //aktorzy już istnieją, gdy korzeń umarł - ruszam ich pierwszymi komunikatami
+    while (actor_stats(actor, &(actor_stats_t){0}) == 0)
+        sched_yield();
+    message_t high = {.message_type = MSG_SPIN, .data = &high_count};
+    message_t background = {.message_type = MSG_SPIN, .data = &background_count};
+    //id dzieci korzenia (miejsca po kolei, pierwsze pokolenie)
+    for (actor_id_t id = 1; id <= 4; id++)
+        mu_assert("start high", send_message(id, high) == 0);
+    mu_assert("start background", send_message(5, background) == 0);
+
+    //ważni aktorzy są cały czas gotowi, a tło i tak dostaje swoją część
+    while (atomic_load(&background_count) < BACKGROUND_GOAL)
+        sched_yield();
+    atomic_store(&stop, true);
+
+    actor_system_stats_t s;
+    mu_assert("stats", actor_system_stats(&s) == 0);
+    mu_assert("high activations", s.classes[ACTOR_CLASS_HIGH].activations > 0);
+    mu_assert("background activations", s.classes[ACTOR_CLASS_BACKGROUND].activations > 0);
+    mu_assert("high progressed", atomic_load(&high_count) > 0);
+    mu_assert("max bounds p99", s.classes[ACTOR_CLASS_HIGH].wait_p99_ns <= s.classes[ACTOR_CLASS_HIGH].wait_max_ns);
+    actor_system_join(actor);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(high_first);
+    mu_run_test(no_starvation);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
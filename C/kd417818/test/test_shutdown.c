@@ -0,0 +1,268 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define MSG_WORK 1
+#define MSG_HOLD 2
+#define MSG_READY 1
+
+#define CHILDREN 10000
+#define WORK 100
+#define MS 1000000ul
+
+int tests_run = 0;
+
+_Atomic long born;
+_Atomic long worked;
+_Atomic long flushed;
+atomic_bool released;
+atomic_bool asking;
+
+role_t role;
+message_t msg_spawn = {.message_type = MSG_SPAWN, .data = &role};
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_fetch_add(&born, 1);
+}
+
+void count_work(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_fetch_add(&worked, 1);
+}
+
+//zajmuje wątek, dopóki test go nie zwolni (albo przez podany czas)
+void hold(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)data;
+    if (nbytes > 0)
+    {
+        usleep(nbytes);
+        return;
+    }
+    while (!atomic_load(&released))
+        sched_yield();
+}
+
+void flush(void **stateptr, const message_t *message)
+{
+    (void)stateptr;
+    if (message->message_type == MSG_WORK)
+        atomic_fetch_add(&flushed, 1);
+}
+
+act_t prompts[] = {hello, count_work, hold};
+role_t role = {.nprompts = 3, .prompts = prompts, .flush = flush};
+
+static void reset()
+{
+    atomic_store(&born, 0);
+    atomic_store(&worked, 0);
+    atomic_store(&flushed, 0);
+    atomic_store(&released, false);
+    atomic_store(&asking, false);
+}
+
+//aktorzy, którzy nigdy nie dostaliby MSG_GODIE, i tak kończą
+static char *drain_idle()
+{
+    reset();
+    actor_id_t root;
+    actor_system_config_t config = {.workers = 2, .mailbox_limit = 2 * CHILDREN};
+    mu_assert("create", actor_system_create_ex(&root, &role, &config) == 0);
+    for (int i = 0; i < CHILDREN; i++)
+        mu_assert("spawn", send_message(root, msg_spawn) == 0);
+    while (atomic_load(&born) < CHILDREN + 1)
+        sched_yield();
+
+    mu_assert("drained", actor_system_shutdown(SHUTDOWN_DRAIN, SHUTDOWN_NO_TIMEOUT) == 0);
+    message_t msg = {.message_type = MSG_WORK};
+    mu_assert("dead", send_message(root, msg) == -1);
+    actor_system_join(root);
+    mu_assert("no work", atomic_load(&worked) == 0);
+    return 0;
+}
+
+void *wait_system(void *sys)
+{
+    actor_system_wait(sys);
+    return NULL;
+}
+
+//przyjęte wcześniej komunikaty są przetwarzane przed śmiercią (na system czeka już inny wątek)
+static char *drain_busy()
+{
+    reset();
+    actor_system_t *sys;
+    actor_id_t root;
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("start", actor_system_start(&sys, &root, &role, &config) == 0);
+    message_t msg = {.message_type = MSG_WORK};
+    for (int i = 0; i < WORK; i++)
+        mu_assert("work", send_message(root, msg) == 0);
+
+    pthread_t waiter;
+    mu_assert("waiter", pthread_create(&waiter, NULL, wait_system, sys) == 0);
+    mu_assert("drained", actor_system_shutdown_of(sys, SHUTDOWN_DRAIN, SHUTDOWN_NO_TIMEOUT) == 0);
+    pthread_join(waiter, NULL);
+    mu_assert("all work", atomic_load(&worked) == WORK && atomic_load(&flushed) == 0);
+    return 0;
+}
+
+//MSG_SPAWN przetwarzany w trakcie zamykania nie tworzy aktora, który by je zatrzymał
+static char *drain_spawn()
+{
+    reset();
+    actor_id_t root;
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&root, &role, &config) == 0);
+    message_t hold = {.message_type = MSG_HOLD, .nbytes = 5000};
+    mu_assert("hold", send_message(root, hold) == 0);
+    mu_assert("spawn", send_message(root, msg_spawn) == 0);
+
+    mu_assert("drained", actor_system_shutdown(SHUTDOWN_DRAIN, 500 * MS) == 0);
+    actor_system_join(root);
+    return 0;
+}
+
+//aktor, który nie skończy na czas, zatrzymuje system; reszta jego poczty idzie do flush
+static char *drain_timeout()
+{
+    reset();
+    actor_id_t root;
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("create", actor_system_create_ex(&root, &role, &config) == 0);
+    message_t hold = {.message_type = MSG_HOLD};
+    message_t msg = {.message_type = MSG_WORK};
+    mu_assert("hold", send_message(root, hold) == 0);
+    for (int i = 0; i < WORK; i++)
+        mu_assert("work", send_message(root, msg) == 0);
+
+    mu_assert("timeout", actor_system_shutdown(SHUTDOWN_DRAIN, 20 * MS) == 1);
+    atomic_store(&released, true);
+    actor_system_join(root);
+    mu_assert("flushed", atomic_load(&worked) == 0 && atomic_load(&flushed) == WORK);
+    return 0;
+}
+
+//zatrzymanie od razu systemu, na który inny wątek już czeka
+static char *stop_now()
+{
+    reset();
+    actor_system_t *sys;
+    actor_id_t root;
+    actor_system_config_t config = {.workers = 2};
+    mu_assert("start", actor_system_start(&sys, &root, &role, &config) == 0);
+    message_t hold = {.message_type = MSG_HOLD};
+    message_t msg = {.message_type = MSG_WORK};
+    mu_assert("hold", send_message(root, hold) == 0);
+    for (int i = 0; i < WORK; i++)
+        mu_assert("work", send_message(root, msg) == 0);
+
+    pthread_t waiter;
+    mu_assert("waiter", pthread_create(&waiter, NULL, wait_system, sys) == 0);
+    mu_assert("bad mode", actor_system_shutdown_of(sys, 7, 0) == -5);
+    mu_assert("stopped", actor_system_shutdown_of(sys, SHUTDOWN_NOW, 0) == 1);
+    atomic_store(&released, true);
+    pthread_join(waiter, NULL);
+    mu_assert("flushed", atomic_load(&worked) == 0 && atomic_load(&flushed) == WORK);
+    mu_assert("no system", actor_system_shutdown(SHUTDOWN_NOW, 0) == -1);
+    return 0;
+}
+
+//prompt czekający w ask_message na odpowiedź, która nie przyjdzie
+void asker_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    send_message(actor_id_self(), msg_spawn);
+}
+
+void asker_ready(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    message_t question = {.message_type = MSG_WORK}, answer;
+    atomic_store(&asking, true);
+    ask_message((actor_id_t)data, question, &answer);
+}
+
+void asker_flush(void **stateptr, const message_t *message)
+{
+    (void)stateptr;
+    if (message->message_type == MSG_READY)
+        atomic_fetch_add(&flushed, 1);
+}
+
+//dziecko pytającego zgłasza się, a pytanie trzyma, dopóki test go nie zwolni
+void silent_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    message_t ready = {.message_type = MSG_READY, .data = (void *)actor_id_self()};
+    send_message((actor_id_t)data, ready);
+}
+
+act_t asker_prompts[] = {asker_hello, asker_ready};
+role_t asker_role = {.nprompts = 2, .prompts = asker_prompts, .coroutine = true, .flush = asker_flush};
+act_t silent_prompts[] = {silent_hello, hold};
+role_t silent_role = {.nprompts = 2, .prompts = silent_prompts};
+
+static char *stop_asking()
+{
+    reset();
+    msg_spawn.data = &silent_role;
+    actor_id_t root;
+    actor_system_config_t config = {.workers = 2};
+    mu_assert("create", actor_system_create_ex(&root, &asker_role, &config) == 0);
+    while (!atomic_load(&asking))
+        sched_yield();
+
+    mu_assert("stopped", actor_system_shutdown(SHUTDOWN_NOW, 0) == 1);
+    atomic_store(&released, true);
+    actor_system_join(root);
+    msg_spawn.data = &role;
+    mu_assert("flushed", atomic_load(&flushed) == 1);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(drain_idle);
+    mu_run_test(drain_busy);
+    mu_run_test(drain_spawn);
+    mu_run_test(drain_timeout);
+    mu_run_test(stop_now);
+    mu_run_test(stop_asking);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
@@ -0,0 +1,110 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sched.h>
+
+#define MSG_COUNT 1
+#define SENT 100
+
+int tests_run = 0;
+
+atomic_bool release_hello;
+_Atomic long counted;
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    //trzyma wątek, dopóki test nie napełni skrzynki
+    while (!atomic_load(&release_hello))
+        sched_yield();
+}
+
+void count(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_fetch_add(&counted, 1);
+}
+
+act_t prompts[] = {hello, count};
+role_t role = {.nprompts = 2, .prompts = prompts};
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+static char *snapshot()
+{
+    actor_id_t actor;
+    atomic_store(&release_hello, false);
+    actor_system_config_t config = {.workers = 2};
+    mu_assert("create", actor_system_create_ex(&actor, &role, &config) == 0);
+
+    message_t msg = {.message_type = MSG_COUNT};
+    for (int i = 0; i < SENT; i++)
+        mu_assert("send", send_message(actor, msg) == 0);
+    atomic_store(&release_hello, true);
+    while (atomic_load(&counted) < SENT)
+        sched_yield();
+
+    actor_stats_t a;
+    mu_assert("actor stats", actor_stats(actor, &a) == 0);
+    //wliczony MSG_HELLO
+    mu_assert("mailbox high water", a.mailbox_high_water == SENT + 1);
+
+    //liczniki aktora rosną po całej paczce - czekam na jej koniec
+    while (actor_stats(actor, &a) == 0 && a.messages < SENT + 1)
+        sched_yield();
+    mu_assert("actor messages", a.messages == SENT + 1);
+
+    actor_system_stats_t s;
+    mu_assert("system stats", actor_system_stats(&s) == 0);
+    mu_assert("workers", s.workers == 2);
+    mu_assert("messages", s.total.messages == SENT + 1);
+    mu_assert("activations", s.total.activations >= 1 && s.total.activations <= SENT + 1);
+    mu_assert("live", s.live_actors == 1);
+    mu_assert("queued from outside", s.queue_high_water >= 1 && s.total.global_taken >= 1);
+    mu_assert("system high water", s.mailbox_high_water == SENT + 1);
+    mu_assert("busiest", s.busiest_actor == actor);
+    //jeden aktor - każda aktywacja poza pierwszą mogła trafić na inny wątek
+    mu_assert("migrations", s.total.migrations < s.total.activations);
+
+    worker_stats_t w0, w1;
+    mu_assert("worker 0", actor_system_worker_stats(0, &w0) == 0);
+    mu_assert("worker 1", actor_system_worker_stats(1, &w1) == 0);
+    mu_assert("per worker sums", w0.messages + w1.messages == s.total.messages);
+    mu_assert("no worker 2", actor_system_worker_stats(2, &w0) == -1);
+
+    send_message(actor, msg_godie);
+    actor_system_join(actor);
+
+    mu_assert("stale actor", actor_stats(actor, &a) == -1);
+    mu_assert("no system", actor_system_stats(&s) == -1);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(snapshot);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
@@ -0,0 +1,262 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define MSG_PEER 1
+#define MSG_PING 2
+#define MSG_PONG 3
+#define MSG_RELEASE 1
+
+#define ROUND_TRIPS 1000
+#define LIFETIMES 100
+#define MS 1000000ul
+
+int tests_run = 0;
+
+actor_system_t *sys_a, *sys_b;
+_Atomic long pongs;
+atomic_bool wrong_system;
+atomic_bool released;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+//każdy prompt sprawdza, że działa na wątku swojego systemu
+static void check_system(actor_system_t *expected)
+{
+    if (actor_system_of(actor_id_self()) != expected)
+        atomic_store(&wrong_system, true);
+}
+
+//korzeń systemu A dostaje id korzenia B i zaczyna odbijanie
+void peer(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    check_system(sys_a);
+    message_t ping = {.message_type = MSG_PING, .data = (void *)actor_id_self()};
+    send_message((actor_id_t)data, ping);
+}
+
+void ping(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    check_system(sys_b);
+    message_t pong = {.message_type = MSG_PONG, .data = (void *)actor_id_self()};
+    send_message((actor_id_t)data, pong);
+}
+
+void pong(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    check_system(sys_a);
+    if (atomic_fetch_add(&pongs, 1) + 1 < ROUND_TRIPS)
+    {
+        message_t ping = {.message_type = MSG_PING, .data = (void *)actor_id_self()};
+        send_message((actor_id_t)data, ping);
+        return;
+    }
+    send_message((actor_id_t)data, msg_godie);
+    send_message(actor_id_self(), msg_godie);
+}
+
+act_t prompts[] = {hello, peer, ping, pong};
+role_t role = {.nprompts = 4, .prompts = prompts};
+
+//zajmuje jedyny wątek swojego systemu, dopóki drugi system go nie zwolni
+void blocking_hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    while (!atomic_load(&released))
+        sched_yield();
+    send_message(actor_id_self(), msg_godie);
+}
+
+act_t blocking_prompts[] = {blocking_hello};
+role_t blocking_role = {.nprompts = 1, .prompts = blocking_prompts};
+
+void release(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_store(&released, true);
+    send_message(actor_id_self(), msg_godie);
+}
+
+act_t release_prompts[] = {hello, release};
+role_t release_role = {.nprompts = 2, .prompts = release_prompts};
+
+static char *cross_system_sends()
+{
+    actor_id_t a, b;
+    atomic_store(&pongs, 0);
+    atomic_store(&wrong_system, false);
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("default", actor_system_create_ex(&a, &role, &config) == 0);
+    mu_assert("second default", actor_system_create_ex(&b, &role, &config) == -1);
+    mu_assert("start", actor_system_start(&sys_b, &b, &role, &config) == 0);
+    sys_a = actor_system_of(a);
+    mu_assert("distinct", sys_a != NULL && sys_b != NULL && sys_a != sys_b);
+    mu_assert("ids", a != b && actor_system_of(b) == sys_b);
+
+    message_t msg = {.message_type = MSG_PEER, .data = (void *)b};
+    mu_assert("peer", send_message(a, msg) == 0);
+    actor_system_join(a);
+    actor_system_wait(sys_b);
+
+    mu_assert("round trips", atomic_load(&pongs) == ROUND_TRIPS);
+    mu_assert("own threads", !atomic_load(&wrong_system));
+    mu_assert("gone", actor_system_of(a) == NULL && actor_system_of(b) == NULL);
+    mu_assert("send after", send_message(b, msg) == -2);
+    return 0;
+}
+
+//system z zajętym wątkiem nie wstrzymuje drugiego - jeden wspólny wątek by tu utknął
+static char *isolation()
+{
+    actor_id_t a, b;
+    atomic_store(&released, false);
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("start a", actor_system_start(&sys_a, &a, &blocking_role, &config) == 0);
+    mu_assert("start b", actor_system_start(&sys_b, &b, &release_role, &config) == 0);
+
+    message_t msg = {.message_type = MSG_RELEASE};
+    mu_assert("release", send_message(b, msg) == 0);
+    actor_system_wait(sys_a);
+    actor_system_wait(sys_b);
+    mu_assert("released", atomic_load(&released));
+    return 0;
+}
+
+//zegar należy do systemu odbiorcy, a jego uchwyt da się odwołać skądkolwiek
+static char *timers()
+{
+    actor_id_t a, b;
+    actor_system_config_t config = {.workers = 1};
+    mu_assert("start a", actor_system_start(&sys_a, &a, &release_role, &config) == 0);
+    mu_assert("start b", actor_system_start(&sys_b, &b, &release_role, &config) == 0);
+
+    message_t msg = {.message_type = MSG_RELEASE};
+    timer_id_t ta, tb;
+    mu_assert("after a", send_message_after(a, msg, 1000 * MS, &ta) == 0);
+    mu_assert("after b", send_message_after(b, msg, 1000 * MS, &tb) == 0);
+    //pierwsze zegary obu kół - różnią je tylko numery systemów
+    mu_assert("distinct handles", ta != tb);
+    mu_assert("cancel b", timer_cancel(tb) == 0);
+    mu_assert("cancel b twice", timer_cancel(tb) == -1);
+    mu_assert("cancel a", timer_cancel(ta) == 0);
+
+    mu_assert("godie a", send_message(a, msg_godie) == 0);
+    mu_assert("godie b", send_message(b, msg_godie) == 0);
+    actor_system_join(b);
+    actor_system_join(a);
+    mu_assert("cancel after", timer_cancel(ta) == -1);
+
+    //kolejny system pod numerem A - stary uchwyt nie odwołuje jego zegara
+    actor_id_t c;
+    actor_system_t *sys_c;
+    timer_id_t tc;
+    mu_assert("start c", actor_system_start(&sys_c, &c, &release_role, &config) == 0);
+    mu_assert("after c", send_message_after(c, msg, 1000 * MS, &tc) == 0);
+    mu_assert("reused handle", timer_cancel(ta) == -1);
+    mu_assert("cancel c", timer_cancel(tc) == 0);
+    mu_assert("godie c", send_message(c, msg_godie) == 0);
+    actor_system_wait(sys_c);
+    return 0;
+}
+
+_Atomic actor_id_t target = -1;
+atomic_bool sending;
+atomic_bool bad_result;
+
+//wysyła do aktualnego korzenia, nie czekając na jego system - ten może się właśnie kończyć
+void *sender(void *arg)
+{
+    int fd = *(int *)arg;
+    message_t msg = {.message_type = MSG_RELEASE};
+    while (atomic_load(&sending))
+    {
+        actor_id_t root = atomic_load(&target);
+        //przyjęty, martwy albo zapchany odbiorca, albo już nie ma jego systemu
+        int err = send_message(root, msg);
+        if (err != 0 && err != -1 && err != -2 && err != -3)
+            atomic_store(&bad_result, true);
+        timer_id_t timer;
+        if (send_message_after(root, msg, 1000 * MS, &timer) == 0)
+            timer_cancel(timer);
+        if (io_watch(root, fd, IO_READ, MSG_RELEASE) == 0)
+            io_unwatch(fd);
+        sched_yield();
+    }
+    return NULL;
+}
+
+//system kończy się i zwalnia, gdy inny wątek wciąż do niego wysyła
+static char *concurrent_sender()
+{
+    int fds[2];
+    mu_assert("pipe", pipe(fds) == 0);
+    atomic_store(&sending, true);
+    atomic_store(&bad_result, false);
+    pthread_t thread;
+    mu_assert("sender", pthread_create(&thread, NULL, sender, &fds[0]) == 0);
+
+    actor_system_config_t config = {.workers = 1};
+    for (int i = 0; i < LIFETIMES; i++)
+    {
+        actor_system_t *sys;
+        actor_id_t root;
+        mu_assert("start", actor_system_start(&sys, &root, &release_role, &config) == 0);
+        atomic_store(&target, root);
+        //korzeń umiera po pierwszym MSG_RELEASE od wysyłającego
+        actor_system_wait(sys);
+    }
+    atomic_store(&sending, false);
+    pthread_join(thread, NULL);
+    close(fds[0]);
+    close(fds[1]);
+    mu_assert("send results", !atomic_load(&bad_result));
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(cross_system_sends);
+    mu_run_test(isolation);
+    mu_run_test(timers);
+    mu_run_test(concurrent_sender);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
@@ -0,0 +1,220 @@
+#include "minunit.h"
+#include "cacti.h"
+#include "wheel.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+
+#define MSG_TICK 1
+#define MSG_TOCK 2
+#define MSG_MARK 3
+
+#define MS 1000000ul
+//tyle zegarów naraz w samym kole
+#define WHEEL_TIMERS (1 << 18)
+
+int tests_run = 0;
+
+_Atomic long ticks;
+_Atomic long order[3];
+_Atomic long arrived;
+_Atomic uint64_t tick_at;
+_Atomic timer_id_t periodic;
+_Atomic long ticks_at_cancel;
+atomic_bool marked;
+_Atomic long late;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+}
+
+//nbytes to numer zegara - zapisuję, który przyszedł jako który
+void tick(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)data;
+    atomic_store(&tick_at, now_ns());
+    atomic_store(&order[atomic_fetch_add(&arrived, 1) % 3], (long)nbytes);
+}
+
+/* okresowy zegar sam się odwołuje po piątym razie; odpalone wcześniej mogą
+jeszcze czekać w skrzynce, ale przed znacznikiem wysłanym po odwołaniu */
+void tock(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    if (atomic_load(&marked))
+        atomic_fetch_add(&late, 1);
+    if (atomic_fetch_add(&ticks, 1) + 1 == 5)
+    {
+        atomic_store(&ticks_at_cancel, timer_cancel(atomic_load(&periodic)) == 0 ? 5 : -1);
+        message_t mark = {.message_type = MSG_MARK};
+        send_message(actor_id_self(), mark);
+        send_message_after(actor_id_self(), msg_godie, 20 * MS, NULL);
+    }
+}
+
+void mark(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    (void)data;
+    atomic_store(&marked, true);
+}
+
+act_t prompts[] = {hello, tick, tock, mark};
+role_t role = {.nprompts = 4, .prompts = prompts};
+
+static char *after_delay()
+{
+    actor_id_t actor;
+    atomic_store(&arrived, 0);
+    actor_system_config_t config = {.workers = 2};
+    mu_assert("create", actor_system_create_ex(&actor, &role, &config) == 0);
+
+    //wszystkie wątki zdążą zasnąć - zegar musi je obudzić
+    uint64_t start = now_ns();
+    message_t msg = {.message_type = MSG_TICK};
+    msg.nbytes = 30;
+    mu_assert("after 30", send_message_after(actor, msg, 30 * MS, NULL) == 0);
+    msg.nbytes = 10;
+    mu_assert("after 10", send_message_after(actor, msg, 10 * MS, NULL) == 0);
+    msg.nbytes = 20;
+    mu_assert("after 20", send_message_after(actor, msg, 20 * MS, NULL) == 0);
+    mu_assert("no actor", send_message_after(actor + 1, msg, MS, NULL) == -2);
+    while (atomic_load(&arrived) < 3)
+        sched_yield();
+
+    mu_assert("not early", atomic_load(&tick_at) - start >= 30 * MS);
+    mu_assert("in order", atomic_load(&order[0]) == 10 && atomic_load(&order[1]) == 20 && atomic_load(&order[2]) == 30);
+    mu_assert("godie", send_message(actor, msg_godie) == 0);
+    actor_system_join(actor);
+    return 0;
+}
+
+static char *cancel()
+{
+    actor_id_t actor;
+    atomic_store(&arrived, 0);
+    atomic_store(&ticks, 0);
+    atomic_store(&ticks_at_cancel, 0);
+    atomic_store(&marked, false);
+    atomic_store(&late, 0);
+    actor_system_config_t config = {.workers = 2};
+    mu_assert("create", actor_system_create_ex(&actor, &role, &config) == 0);
+
+    timer_id_t once;
+    message_t msg = {.message_type = MSG_TICK};
+    mu_assert("after", send_message_after(actor, msg, 10 * MS, &once) == 0);
+    mu_assert("cancelled", timer_cancel(once) == 0);
+    mu_assert("cancelled twice", timer_cancel(once) == -1);
+
+    //co 2 ms, aż prompt go odwoła; potem już nic nie przychodzi
+    message_t every = {.message_type = MSG_TOCK};
+    timer_id_t handle;
+    mu_assert("every", send_message_every(actor, every, 2 * MS, &handle) == 0);
+    atomic_store(&periodic, handle);
+    actor_system_join(actor);
+
+    mu_assert("cancelled one never fired", atomic_load(&arrived) == 0);
+    mu_assert("periodic cancelled", atomic_load(&ticks_at_cancel) == 5);
+    mu_assert("nothing after cancel", atomic_load(&marked) && atomic_load(&late) == 0);
+    return 0;
+}
+
+long fired;
+bool on_time;
+
+//nbytes to takt, w którym zegar miał odpalić
+bool check_fire(void *arg, actor_id_t to, message_t message)
+{
+    wheel_t *w = arg;
+    (void)to;
+    fired++;
+    if (message.nbytes != w->now)
+        on_time = false;
+    return true;
+}
+
+static char *wheel_many()
+{
+    wheel_t w;
+    wheel_init(&w);
+    long *handles = malloc(WHEEL_TIMERS * sizeof(long));
+    mu_assert("alloc", handles != NULL);
+
+    //zegary na wszystkich poziomach koła
+    srand(1);
+    for (long i = 0; i < WHEEL_TIMERS; i++)
+    {
+        uint64_t r = (uint64_t)rand() << 16 ^ (uint64_t)rand();
+        uint64_t expires = 1 + r % (i % 16 == 0 ? WHEEL_RANGE : 1 << 16);
+        message_t msg = {.nbytes = expires};
+        handles[i] = wheel_add(&w, 0, msg, expires, 0);
+        mu_assert("add", handles[i] >= 0);
+    }
+    long cancelled = 0;
+    for (long i = 0; i < WHEEL_TIMERS; i += 3)
+    {
+        mu_assert("cancel", wheel_cancel(&w, handles[i]));
+        cancelled++;
+    }
+    mu_assert("count", w.count == (size_t)(WHEEL_TIMERS - cancelled));
+
+    fired = 0;
+    on_time = true;
+    //czas przesuwany nierównymi skokami, na końcu za ostatni zegar
+    for (uint64_t until = 1; until < WHEEL_RANGE; until += until / 3 + 7)
+        wheel_advance(&w, until, check_fire, &w);
+    wheel_advance(&w, WHEEL_RANGE, check_fire, &w);
+
+    mu_assert("all fired", fired == WHEEL_TIMERS - cancelled);
+    mu_assert("on time", on_time);
+    mu_assert("empty", w.count == 0 && wheel_next(&w) == UINT64_MAX);
+    mu_assert("fired not cancellable", !wheel_cancel(&w, handles[1]));
+    free(handles);
+    wheel_destroy(&w);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(after_delay);
+    mu_run_test(cancel);
+    mu_run_test(wheel_many);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
@@ -0,0 +1,142 @@
+#include "minunit.h"
+#include "cacti.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MSG_PING 1
+#define ROUNDS 50
+#define TRACE_FILE "test_trace.json"
+
+int tests_run = 0;
+
+role_t role;
+long pings;
+
+message_t msg_godie = {.message_type = MSG_GODIE};
+
+//korzeń tworzy dziecko, które odbija komunikat ROUNDS razy
+void hello(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    if ((actor_id_t)data == -1)
+    {
+        message_t spawn = {.message_type = MSG_SPAWN, .data = &role};
+        send_message(actor_id_self(), spawn);
+        return;
+    }
+    message_t ping = {.message_type = MSG_PING, .data = (void *)actor_id_self()};
+    send_message((actor_id_t)data, ping);
+}
+
+void ping(void **stateptr, size_t nbytes, void *data)
+{
+    (void)stateptr;
+    (void)nbytes;
+    if (++pings >= ROUNDS)
+    {
+        send_message((actor_id_t)data, msg_godie);
+        send_message(actor_id_self(), msg_godie);
+        return;
+    }
+    message_t back = {.message_type = MSG_PING, .data = (void *)actor_id_self()};
+    send_message((actor_id_t)data, back);
+}
+
+act_t prompts[] = {hello, ping};
+
+//liczba wystąpień napisu w pliku
+static long occurrences(const char *text, const char *what)
+{
+    long n = 0;
+    for (const char *p = strstr(text, what); p != NULL; p = strstr(p + 1, what))
+        n++;
+    return n;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = malloc(size + 1);
+    size_t got = fread(text, 1, size, f);
+    text[got] = '\0';
+    fclose(f);
+    return text;
+}
+
+static char *chrome_trace()
+{
+    role.nprompts = 2;
+    role.prompts = prompts;
+    pings = 0;
+    unlink(TRACE_FILE);
+
+    actor_id_t actor;
+    actor_system_config_t config = {.workers = 2, .trace_file = TRACE_FILE};
+    mu_assert("create", actor_system_create_ex(&actor, &role, &config) == 0);
+    actor_system_join(actor);
+
+    char *text = read_file(TRACE_FILE);
+    mu_assert("trace written", text != NULL);
+    mu_assert("chrome format", strncmp(text, "{\"displayTimeUnit\"", 18) == 0);
+    /* aktywacji (i końców strzałek, zapisywanych przy pierwszym komunikacie
+    aktywacji) może być mniej niż odbić - odpowiedź, która przyjdzie przed
+    oddaniem skrzynki, obsługuje jeszcze ta sama aktywacja */
+    long begins = occurrences(text, "\"ph\":\"B\"");
+    mu_assert("activations closed", begins > 0 && begins == occurrences(text, "\"ph\":\"E\""));
+    mu_assert("sends", occurrences(text, "\"name\":\"send\"") >= ROUNDS);
+    long flows = occurrences(text, "\"ph\":\"s\"");
+    mu_assert("flows", flows >= ROUNDS && occurrences(text, "\"ph\":\"f\"") <= flows);
+    mu_assert("spawn", occurrences(text, "\"name\":\"spawn\"") == 1);
+    mu_assert("godie", occurrences(text, "\"name\":\"godie\"") == 2);
+    free(text);
+    unlink(TRACE_FILE);
+    return 0;
+}
+
+static char *no_trace()
+{
+    role.nprompts = 2;
+    role.prompts = prompts;
+    pings = 0;
+    unlink(TRACE_FILE);
+    unsetenv("CACTI_TRACE");
+
+    actor_id_t actor;
+    mu_assert("create", actor_system_create(&actor, &role) == 0);
+    actor_system_join(actor);
+    mu_assert("nothing written", access(TRACE_FILE, F_OK) != 0);
+    return 0;
+}
+
+static char *all_tests()
+{
+    mu_run_test(chrome_trace);
+    mu_run_test(no_trace);
+    return 0;
+}
+
+int main()
+{
+    char *result = all_tests();
+    if (result != 0)
+    {
+        printf(__FILE__ ": %s\n", result);
+    }
+    else
+    {
+        printf(__FILE__ ": ALL TESTS PASSED\n");
+    }
+    printf(__FILE__ ": Tests run: %d\n", tests_run);
+
+    return result != 0;
+}
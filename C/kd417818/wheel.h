@@ -0,0 +1,245 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+/* hierarchiczne koło zegarów (Varghese, Lauck): WHEEL_LEVELS poziomów po
+WHEEL_SLOTS przegródek, przegródka poziomu l obejmuje WHEEL_SLOTS^l taktów;
+zegar trafia na najniższy poziom, na którym mieści się jego odległość od
+teraz, a gdy czas dojdzie do jego przegródki - schodzi poziom niżej (kaskada);
+dodanie i odwołanie O(1); bez synchronizacji - chroni je właściciel koła */
+
+#include "cacti.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK ((uint64_t)WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 6
+//najdalszy takt, na jaki da się nastawić zegar (dalsze są przycinane)
+#define WHEEL_RANGE (((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+//węzły to indeksy w tablicy, która rośnie przez realloc; to jest brak węzła
+#define TNODE_NONE UINT32_MAX
+//tyle węzłów dostaje nowe koło
+#define WHEEL_INITIAL 1024
+
+//zegar: komunikat do aktora w takcie expires (i co period taktów, jeśli niezerowe)
+typedef struct tnode {
+    uint64_t expires;
+    uint64_t period;
+    actor_id_t to;
+    message_t message;
+    uint32_t prev;
+    uint32_t next;  //w przegródce albo na stosie wolnych
+    uint32_t gen;   //pokolenie węzła - uchwyt zwolnionego zegara przestaje działać
+    uint32_t slot;  //poziom * WHEEL_SLOTS + przegródka, TNODE_NONE - węzeł wolny
+} tnode_t;
+
+typedef struct wheel {
+    uint64_t now; //ostatni obsłużony takt
+    uint32_t heads[WHEEL_LEVELS * WHEEL_SLOTS];
+    //niepuste przegródki każdego poziomu (do szukania najbliższego zdarzenia)
+    uint64_t occupied[WHEEL_LEVELS];
+    tnode_t* nodes;
+    uint32_t capacity;
+    uint32_t free;
+    size_t count; //zegary w kole
+} wheel_t;
+
+/* uchwyt zegara: pokolenie (15 bitów) i numer węzła; górne 16 bitów zostaje
+zerowych dla właściciela koła (zawsze dodatni), -1 to żaden zegar */
+#define TNODE_GEN_MASK 0x7fff
+
+static inline long tnode_handle(const wheel_t* w, uint32_t i) {
+    return (long)(((uint64_t)(w->nodes[i].gen & TNODE_GEN_MASK) << 32) | i);
+}
+
+static inline void wheel_init(wheel_t* w) {
+    w->now = 0;
+    for (size_t s = 0; s < WHEEL_LEVELS * WHEEL_SLOTS; s++)
+        w->heads[s] = TNODE_NONE;
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+        w->occupied[l] = 0;
+    w->nodes = NULL;
+    w->capacity = 0;
+    w->free = TNODE_NONE;
+    w->count = 0;
+}
+
+static inline void wheel_destroy(wheel_t* w) {
+    free(w->nodes);
+    w->nodes = NULL;
+    w->capacity = 0;
+    w->free = TNODE_NONE;
+    w->count = 0;
+}
+
+//wstawia węzeł do przegródki według jego odległości od w->now (expires >= now)
+static inline void wheel_link(wheel_t* w, uint32_t i) {
+    tnode_t* n = &w->nodes[i];
+    uint64_t delta = n->expires - w->now;
+    int level = delta == 0 ? 0 : (63 - __builtin_clzll(delta)) / WHEEL_BITS;
+    if (level >= WHEEL_LEVELS)
+        level = WHEEL_LEVELS - 1;
+    uint32_t bucket = (uint32_t)((n->expires >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    uint32_t slot = (uint32_t)level * WHEEL_SLOTS + bucket;
+
+    n->slot = slot;
+    n->prev = TNODE_NONE;
+    n->next = w->heads[slot];
+    if (n->next != TNODE_NONE)
+        w->nodes[n->next].prev = i;
+    w->heads[slot] = i;
+    w->occupied[level] |= (uint64_t)1 << bucket;
+}
+
+static inline void wheel_unlink(wheel_t* w, uint32_t i) {
+    tnode_t* n = &w->nodes[i];
+    if (n->prev != TNODE_NONE)
+        w->nodes[n->prev].next = n->next;
+    else
+        w->heads[n->slot] = n->next;
+    if (n->next != TNODE_NONE)
+        w->nodes[n->next].prev = n->prev;
+    if (w->heads[n->slot] == TNODE_NONE)
+        w->occupied[n->slot / WHEEL_SLOTS] &= ~((uint64_t)1 << (n->slot % WHEEL_SLOTS));
+}
+
+//zabiera całą listę przegródki (zwraca pierwszy węzeł)
+static inline uint32_t wheel_take(wheel_t* w, uint32_t slot) {
+    uint32_t first = w->heads[slot];
+    w->heads[slot] = TNODE_NONE;
+    w->occupied[slot / WHEEL_SLOTS] &= ~((uint64_t)1 << (slot % WHEEL_SLOTS));
+    return first;
+}
+
+static inline void wheel_release(wheel_t* w, uint32_t i) {
+    tnode_t* n = &w->nodes[i];
+    n->slot = TNODE_NONE;
+    n->gen++;
+    n->next = w->free;
+    w->free = i;
+    w->count--;
+}
+
+/* nastawia zegar na takt expires (najwcześniej następny, najpóźniej za
+WHEEL_RANGE); zwraca uchwyt albo -1, gdy zabrakło pamięci */
+static inline long wheel_add(wheel_t* w, actor_id_t to, message_t message, uint64_t expires, uint64_t period) {
+    if (w->free == TNODE_NONE) {
+        uint32_t capacity = w->capacity == 0 ? WHEEL_INITIAL : w->capacity * 2;
+        if (capacity <= w->capacity || capacity == TNODE_NONE)
+            return -1;
+        tnode_t* nodes = (tnode_t*)realloc(w->nodes, (size_t)capacity * sizeof(tnode_t));
+        if (nodes == NULL)
+            return -1;
+        //nowe węzły na stos wolnych, od najniższego numeru
+        for (uint32_t i = capacity; i-- > w->capacity;) {
+            nodes[i].gen = 0;
+            nodes[i].slot = TNODE_NONE;
+            nodes[i].next = w->free;
+            w->free = i;
+        }
+        w->nodes = nodes;
+        w->capacity = capacity;
+    }
+
+    uint32_t i = w->free;
+    tnode_t* n = &w->nodes[i];
+    w->free = n->next;
+    w->count++;
+
+    if (expires <= w->now)
+        expires = w->now + 1;
+    if (expires - w->now > WHEEL_RANGE)
+        expires = w->now + WHEEL_RANGE;
+    n->expires = expires;
+    n->period = period;
+    n->to = to;
+    n->message = message;
+    wheel_link(w, i);
+    return tnode_handle(w, i);
+}
+
+//odwołuje zegar; false, gdy już go nie ma (odpalił albo był odwołany)
+static inline bool wheel_cancel(wheel_t* w, long handle) {
+    if (handle < 0)
+        return false;
+    uint32_t i = (uint32_t)((uint64_t)handle & 0xffffffff);
+    if (i >= w->capacity || w->nodes[i].slot == TNODE_NONE || tnode_handle(w, i) != handle)
+        return false;
+    wheel_unlink(w, i);
+    wheel_release(w, i);
+    return true;
+}
+
+/* najbliższy takt, w którym koło ma coś do zrobienia (odpalenie albo kaskadę),
+UINT64_MAX dla pustego */
+static inline uint64_t wheel_next(const wheel_t* w) {
+    uint64_t best = UINT64_MAX;
+    for (int l = 0; l < WHEEL_LEVELS; l++) {
+        uint64_t occupied = w->occupied[l];
+        if (occupied == 0)
+            continue;
+        //bit j obróconej mapy to przegródka cur + 1 + j
+        uint64_t cur = w->now >> (WHEEL_BITS * l);
+        unsigned r = (unsigned)((cur + 1) & WHEEL_MASK);
+        uint64_t rotated = r == 0 ? occupied : (occupied >> r) | (occupied << (WHEEL_SLOTS - r));
+        uint64_t at = (cur + 1 + (uint64_t)__builtin_ctzll(rotated)) << (WHEEL_BITS * l);
+        if (at < best)
+            best = at;
+    }
+    return best;
+}
+
+/* przesuwa czas koła do taktu until, odpalając po kolei zegary, których takt
+minął: fire dostaje odbiorcę i komunikat, a false od niego kończy zegar
+okresowy; okresowy, który nie zdążył odpalić kilka razy, odpala raz */
+static inline void wheel_advance(wheel_t* w, uint64_t until, bool (*fire)(void*, actor_id_t, message_t), void* arg) {
+    while (w->now < until) {
+        //puste takty przeskakuję
+        uint64_t next = wheel_next(w);
+        if (next > until) {
+            w->now = until;
+            return;
+        }
+        w->now = next;
+
+        //kaskady od najwyższego poziomu - zegar może zejść kilka poziomów naraz
+        for (int l = WHEEL_LEVELS - 1; l > 0; l--) {
+            if ((w->now & (((uint64_t)1 << (WHEEL_BITS * l)) - 1)) != 0)
+                continue;
+            uint32_t i = wheel_take(w, (uint32_t)l * WHEEL_SLOTS + (uint32_t)((w->now >> (WHEEL_BITS * l)) & WHEEL_MASK));
+            while (i != TNODE_NONE) {
+                uint32_t next_node = w->nodes[i].next;
+                wheel_link(w, i);
+                i = next_node;
+            }
+        }
+
+        uint32_t i = wheel_take(w, (uint32_t)(w->now & WHEEL_MASK));
+        while (i != TNODE_NONE) {
+            tnode_t* n = &w->nodes[i];
+            uint32_t next_node = n->next;
+            actor_id_t to = n->to;
+            message_t message = n->message;
+            if (n->period == 0) {
+                wheel_release(w, i);
+                fire(arg, to, message);
+            }
+            else {
+                n->expires += n->period * ((w->now - n->expires) / n->period + 1);
+                if (n->expires - w->now > WHEEL_RANGE)
+                    n->expires = w->now + WHEEL_RANGE;
+                wheel_link(w, i);
+                if (!fire(arg, to, message)) {
+                    wheel_unlink(w, i);
+                    wheel_release(w, i);
+                }
+            }
+            i = next_node;
+        }
+    }
+}
+
+#endif